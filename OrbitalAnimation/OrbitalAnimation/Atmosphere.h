@@ -0,0 +1,78 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#include "Simd.h"
+
+// Piecewise exponential atmosphere: within each layer density falls off with
+// that layer's scale height, continuous across layer floors. It is sampled
+// once into a table, so the step kernels interpolate instead of calling exp().
+
+struct AtmosphereLayer
+{
+    float base;                   // altitude of the layer floor
+    float scaleHeight;
+};
+
+const AtmosphereLayer ATMOSPHERE_LAYERS[] = {
+    { 0.f, 5.f }, { 10.f, 6.f }, { 20.f, 8.f }, { 35.f, 11.f }, { 50.f, 15.f }
+};
+const float ATMOSPHERE_CEILING = 80.f;     // no drag above this altitude
+const float ATMOSPHERE_SURFACE_DENSITY = 1.f;
+const int ATMOSPHERE_SAMPLES = 256;        // interpolation error under 0.3% of the density
+
+// Exact piecewise density, for building the table.
+inline double layeredDensity(double altitude, double surfaceDensity = ATMOSPHERE_SURFACE_DENSITY)
+{
+    double rho = surfaceDensity;
+    const size_t layers = std::size(ATMOSPHERE_LAYERS);
+    for (size_t i = 0; i < layers; ++i)
+    {
+        double top = i + 1 < layers ? ATMOSPHERE_LAYERS[i + 1].base : ATMOSPHERE_CEILING;
+        double span = std::clamp(altitude, static_cast<double>(ATMOSPHERE_LAYERS[i].base), top) - ATMOSPHERE_LAYERS[i].base;
+        rho *= std::exp(-span / ATMOSPHERE_LAYERS[i].scaleHeight);
+        if (altitude <= top) break;
+    }
+    return rho;
+}
+
+struct DensityTable
+{
+    float surface = 0.f;          // radius of altitude zero
+    float ceiling = 0.f;          // altitude above which density is zero
+    float invStep = 0.f;
+    std::vector<float> rho;       // samples at altitude i / invStep; the last one is at the ceiling
+
+    float at(float altitude) const
+    {
+        if (!(altitude < ceiling)) return 0.f;
+        float u = std::max(altitude, 0.f) * invStep;
+        int i = std::min(static_cast<int>(u), static_cast<int>(rho.size()) - 2);
+        float f = u - static_cast<float>(i);
+        return rho[i] + (rho[i + 1] - rho[i]) * f;
+    }
+
+    // Four lanes at once; the table reads are scalar (SSE2 has no gather).
+    f32x4 at(f32x4 altitude) const
+    {
+        alignas(16) float a[4];
+        altitude.store(a);
+        return f32x4(at(a[0]), at(a[1]), at(a[2]), at(a[3]));
+    }
+};
+
+inline DensityTable makeDensityTable(float surfaceRadius, float surfaceDensity = ATMOSPHERE_SURFACE_DENSITY)
+{
+    DensityTable t;
+    t.surface = surfaceRadius;
+    t.ceiling = ATMOSPHERE_CEILING;
+    t.invStep = static_cast<float>(ATMOSPHERE_SAMPLES - 1) / ATMOSPHERE_CEILING;
+    t.rho.resize(ATMOSPHERE_SAMPLES);
+    for (int i = 0; i < ATMOSPHERE_SAMPLES; ++i)
+        t.rho[i] = static_cast<float>(layeredDensity(ATMOSPHERE_CEILING * i / (ATMOSPHERE_SAMPLES - 1), surfaceDensity));
+    return t;
+}
@@ -0,0 +1,223 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "Ensemble.h"
+#include "Kepler.h"
+#include "Swarm.h"
+
+// Collisions and fragmentation after the NASA standard breakup model (SBM).
+// For colliding masses m_t >= m_p at relative speed v the event is
+// catastrophic when 0.5 m_p v^2 / m_t >= 40 J/g; then the fragmenting mass is
+// M = m_t + m_p, otherwise M = m_p v^2 with v in km/s. Fragments with
+// characteristic length Lc (m) follow N(>= Lc) = 0.1 M^0.75 Lc^-1.71; each
+// draws an area-to-mass ratio chi = log10(A/M) from the SBM's size-dependent
+// (log-normal) distributions, its mass from A = 0.556945 Lc^2.0047077, and an
+// isotropic ejection speed with log10(dv) ~ N(0.9 chi + 2.9, 0.4), dv in m/s.
+// Sizes between the SBM's small-debris (< 8 cm) and spacecraft (> 11 cm)
+// laws use the small-debris one. Fragments leave from the centre of mass, and
+// whatever mass the sampled ones leave over stays in one remnant on its path.
+
+const float BREAKUP_MIN_LENGTH = 0.1f;         // m, smallest fragment tracked
+const float BREAKUP_MAX_LENGTH = 10.f;         // m, Lc draws are clamped here
+const int BREAKUP_MAX_FRAGMENTS = 4000;        // per event, remnant excluded
+const float BREAKUP_CATASTROPHIC = 40.f;       // J/g, specific energy threshold
+const float BREAKUP_SPEED_SCALE = 2.3f / 7800.f; // sim speed per m/s: LEO circular speed maps to 7.8 km/s
+
+// Fragments of at least minLength from a fragmenting mass M (kg).
+inline double breakupFragmentCount(double mass, double minLength)
+{
+    return 0.1 * std::pow(mass, 0.75) * std::pow(minLength, -1.71);
+}
+
+// Mass (kg) that fragments when m1 and m2 collide at relative speed v (m/s).
+inline double breakupMass(double m1, double m2, double v)
+{
+    double target = std::max(m1, m2), projectile = std::min(m1, m2);
+    double specific = 0.5 * projectile * v * v / (target * 1000.0);
+    return specific >= BREAKUP_CATASTROPHIC ? target + projectile : projectile * (v / 1000.0) * (v / 1000.0);
+}
+
+// Mean and deviation of chi for the spacecraft law's two modes and the weight
+// of the first, or the small-debris law (alpha = 1), at lambda = log10(Lc).
+// Every piece is linear between its breakpoints and flat outside them.
+struct AreaToMassLaw
+{
+    double alpha, mu1, sigma1, mu2, sigma2;
+};
+
+inline AreaToMassLaw areaToMassLaw(double lambda)
+{
+    auto ramp = [lambda](double lo, double hi, double atLo, double atHi)
+    {
+        double f = std::clamp((lambda - lo) / (hi - lo), 0.0, 1.0);
+        return atLo + (atHi - atLo) * f;
+    };
+    AreaToMassLaw law;
+    if (lambda < std::log10(0.11))
+    {
+        law.alpha = 1.0;
+        law.mu1 = law.mu2 = ramp(-1.75, -1.25, -0.3, -1.0);
+        law.sigma1 = law.sigma2 = lambda <= -3.5 ? 0.2 : 0.2 + 0.1333 * (lambda + 3.5);
+        return law;
+    }
+    law.alpha = ramp(-1.95, 0.55, 0.0, 1.0);
+    law.mu1 = ramp(-1.1, 0.0, -0.6, -0.95);
+    law.sigma1 = ramp(-1.3, -0.3, 0.1, 0.3);
+    law.mu2 = ramp(-0.7, -0.1, -1.2, -2.0);
+    law.sigma2 = ramp(-0.5, -0.3, 0.5, 0.3);
+    return law;
+}
+
+// Number of tracked fragments an event yields: the SBM count, capped, with
+// its fractional part drawn. event and seed pick the random stream.
+inline size_t breakupCount(double fragmentingMass, uint64_t seed, uint32_t event)
+{
+    double expected = std::min(breakupFragmentCount(fragmentingMass, BREAKUP_MIN_LENGTH), double(BREAKUP_MAX_FRAGMENTS));
+    auto draw = philox4x32({ 0u, event, 3u, 1u }, { uint32_t(seed), uint32_t(seed >> 32) });
+    return static_cast<size_t>(expected) + (uniform01(draw[0]) < expected - std::floor(expected) ? 1 : 0);
+}
+
+// Fragment the combined state of a collision (relative to the center):
+// emit(state, mass, length, areaToMass) receives count fragments (from
+// breakupCount) and then the remnant carrying the rest of totalMass, which
+// has length and areaToMass 0. Returns the number of bodies emitted.
+template <typename Emit>
+inline size_t breakupFragments(const KeplerState& at, double totalMass, size_t count, uint64_t seed, uint32_t event, Emit emit)
+{
+    auto normal = [&](uint32_t a, uint32_t b) { return std::sqrt(-2.0 * std::log(uniform01(a))) * std::cos(2.0 * KEPLER_PI * uniform01(b)); };
+
+    double left = totalMass;
+    size_t emitted = 0;
+    for (size_t k = 0; k < count && left > 0.0; ++k)
+    {
+        auto a = philox4x32({ uint32_t(k), event, 3u, 0u }, { uint32_t(seed), uint32_t(seed >> 32) });
+        auto b = philox4x32({ uint32_t(k), event, 3u, 2u }, { uint32_t(seed), uint32_t(seed >> 32) });
+
+        double length = std::min(BREAKUP_MIN_LENGTH * std::pow(uniform01(a[0]), -1.0 / 1.71), double(BREAKUP_MAX_LENGTH));
+        AreaToMassLaw law = areaToMassLaw(std::log10(length));
+        bool first = uniform01(a[1]) < law.alpha;
+        double chi = first ? law.mu1 + law.sigma1 * normal(a[2], a[3]) : law.mu2 + law.sigma2 * normal(a[2], a[3]);
+
+        double area = 0.556945 * std::pow(length, 2.0047077);
+        double mass = std::min(area / std::pow(10.0, chi), left);
+        double dv = std::pow(10.0, 0.9 * chi + 2.9 + 0.4 * normal(b[0], b[1])) * BREAKUP_SPEED_SCALE;
+        double angle = 2.0 * KEPLER_PI * uniform01(b[2]);
+
+        emit(KeplerState{ at.r, at.v + Vec2d(std::cos(angle), std::sin(angle)) * dv }, mass, length, area / mass);
+        left -= mass;
+        ++emitted;
+    }
+    if (left > 0.0)
+    {
+        emit(at, left, 0.0, 0.0);
+        ++emitted;
+    }
+    return emitted;
+}
+
+// Fragments of one event into the swarm, its pool reserved for all of them up front.
+inline size_t spawnBreakup(Swarm& swarm, const KeplerState& at, double totalMass, double fragmentingMass,
+    uint64_t seed, uint32_t event, sf::Vector2f center, float armed)
+{
+    size_t count = breakupCount(fragmentingMass, seed, event);
+    swarm.reserve(count + 1);
+    return breakupFragments(at, totalMass, count, seed, event, [&](const KeplerState& s, double mass, double, double)
+    {
+        swarm.push(center, s, SwarmKind::Fragment, static_cast<float>(mass), armed);
+    });
+}
+
+// Broad and narrow phase for equal-radius bodies. Bodies go into a uniform
+// grid of cells twice the contact distance wide, which wraps around: a cell's
+// bucket is the low bits of its x and y, so neighbouring cells are
+// neighbouring buckets and far cells that share one are told apart by their
+// coordinates. One counting sort orders the bodies by bucket, so building
+// costs O(n) and the scan below walks memory in order. A body can only touch
+// bodies in its own cell and the three neighbours on the sides nearest to it,
+// so each query visits four buckets.
+struct CollisionGrid
+{
+    std::vector<float> x, y;
+    std::vector<uint32_t> handle;     // the caller's identity of each body
+    std::vector<uint32_t> start, bucket;
+    std::vector<float> sx, sy;        // positions in bucket order
+    std::vector<uint32_t> sorted;     // index of each bucket-order entry
+    std::vector<uint8_t> used;        // by bucket-order entry
+
+    void clear() { x.clear(); y.clear(); handle.clear(); }
+
+    void add(float px, float py, uint32_t h)
+    {
+        x.push_back(px); y.push_back(py);
+        handle.push_back(h);
+    }
+
+    size_t size() const { return x.size(); }
+
+    // Pairs of handles closer than `distance`, each body in at most one pair.
+    void pairs(float distance, std::vector<std::pair<uint32_t, uint32_t>>& out)
+    {
+        out.clear();
+        const size_t n = size();
+        if (n < 2) return;
+
+        const float inv = 1.f / (2.f * distance), d2 = distance * distance;
+        int bits = 1;
+        while ((size_t(1) << bits) < n) ++bits;
+        const int xBits = (bits + 1) / 2;
+        const uint32_t xMask = (1u << xBits) - 1, yMask = (1u << (bits - xBits)) - 1;
+        auto cellOf = [inv](float v) { return static_cast<int32_t>(std::floor(v * inv)); };
+        auto bucketOf = [=](int32_t cx, int32_t cy) { return (uint32_t(cx) & xMask) | ((uint32_t(cy) & yMask) << xBits); };
+
+        const size_t buckets = size_t(1) << bits;
+        start.assign(buckets + 1, 0);
+        bucket.resize(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            bucket[i] = bucketOf(cellOf(x[i]), cellOf(y[i]));
+            ++start[bucket[i] + 1];
+        }
+        for (size_t b = 0; b < buckets; ++b) start[b + 1] += start[b];
+        sx.resize(n); sy.resize(n); sorted.resize(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            uint32_t s = start[bucket[i]]++;
+            sx[s] = x[i]; sy[s] = y[i];
+            sorted[s] = static_cast<uint32_t>(i);
+        }
+        for (size_t b = buckets; b > 0; --b) start[b] = start[b - 1];
+        start[0] = 0;
+        used.assign(n, 0);
+
+        // the own bucket is scanned only past the body itself (earlier entries
+        // already had their turn), which keeps a dense cloud in one cell linear
+        for (uint32_t i = 0; i < n; ++i)
+        {
+            if (used[i]) continue;
+            float fx = sx[i] * inv, fy = sy[i] * inv;
+            int32_t cx = static_cast<int32_t>(std::floor(fx)), cy = static_cast<int32_t>(std::floor(fy));
+            int32_t nx = fx - cx < 0.5f ? cx - 1 : cx + 1, ny = fy - cy < 0.5f ? cy - 1 : cy + 1;
+            const int32_t qx[4] = { cx, nx, cx, nx }, qy[4] = { cy, cy, ny, ny };
+
+            for (int q = 0; q < 4 && !used[i]; ++q)
+            {
+                uint32_t b = bucketOf(qx[q], qy[q]);
+                for (uint32_t j = q == 0 ? i + 1 : start[b]; j < start[b + 1]; ++j)
+                {
+                    if (used[j]) continue;
+                    float dx = sx[j] - sx[i], dy = sy[j] - sy[i];
+                    if (dx * dx + dy * dy >= d2 || cellOf(sx[j]) != qx[q] || cellOf(sy[j]) != qy[q]) continue;
+                    out.push_back({ handle[sorted[i]], handle[sorted[j]] });
+                    used[i] = used[j] = 1;
+                    break;
+                }
+            }
+        }
+    }
+};
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <system_error>
+
+// Tunables that can be changed while the simulation runs. A config file holds
+// "NAME = value" lines (# starts a comment) named after the constants they
+// override; it is polled for a new modification time and re-read between
+// frames. Each tunable lists which derived state depends on it, so a reload
+// only rebuilds what actually changed.
+
+struct Tunables
+{
+    float g = 0.f;
+    float earthMass = 0.f;
+    float j2 = 0.f;
+    float dragBallistic = 0.f;
+    float surfaceDensity = 0.f;   // scales the whole atmosphere table
+    float maxDt = 0.f;
+    float orbitSpeedScale = 0.f;  // for satellites spawned afterwards
+    size_t maxTrail = 0;
+};
+
+// What a change has to invalidate.
+enum TunableEffect : uint32_t
+{
+    TUNE_NONE = 0,
+    TUNE_FORCE = 1,               // predictions, off-grid propagator states, drift baselines, force tables
+    TUNE_ATMOSPHERE = 2,          // the density table
+    TUNE_TRAIL = 4,               // trail capacity
+};
+
+struct TunableField
+{
+    const char* name;
+    float Tunables::* real;       // exactly one of real / count is set
+    size_t Tunables::* count;
+    uint32_t effects;
+    bool zeroAllowed;             // 0 switches the term off; other fields must be positive
+};
+
+const TunableField TUNABLE_FIELDS[] = {
+    { "G", &Tunables::g, nullptr, TUNE_FORCE, false },
+    { "EARTH_MASS", &Tunables::earthMass, nullptr, TUNE_FORCE, false },
+    { "J2_STRENGTH", &Tunables::j2, nullptr, TUNE_FORCE, true },
+    { "DRAG_BALLISTIC", &Tunables::dragBallistic, nullptr, TUNE_FORCE, true },
+    { "ATMOSPHERE_SURFACE_DENSITY", &Tunables::surfaceDensity, nullptr, TUNE_FORCE | TUNE_ATMOSPHERE, false },
+    { "MAX_DT", &Tunables::maxDt, nullptr, TUNE_NONE, false },
+    { "ORBIT_SPEED_SCALE", &Tunables::orbitSpeedScale, nullptr, TUNE_NONE, false },
+    { "MAX_TRAIL", nullptr, &Tunables::maxTrail, TUNE_TRAIL, false },
+};
+
+// Union of the effects of every field that differs between a and b.
+inline uint32_t tunableEffects(const Tunables& a, const Tunables& b)
+{
+    uint32_t effects = TUNE_NONE;
+    for (const TunableField& f : TUNABLE_FIELDS)
+    {
+        bool differs = f.real ? a.*f.real != b.*f.real : a.*f.count != b.*f.count;
+        if (differs) effects |= f.effects;
+    }
+    return effects;
+}
+
+// Read overrides into t, which keeps its values for names the file leaves out.
+// Returns the number of values read, or -1 if the file cannot be opened.
+// Unknown names, malformed or negative values, and zero for a field that
+// cannot be switched off are reported and skipped.
+inline int loadTunables(const std::string& path, Tunables& t)
+{
+    std::ifstream in(path);
+    if (!in) return -1;
+
+    int count = 0, lineNumber = 0;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        ++lineNumber;
+        line = line.substr(0, line.find('#'));
+        if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+
+        size_t eq = line.find('=');
+        std::string name;
+        double value = 0.0;
+        std::istringstream(line.substr(0, eq)) >> name;
+        bool ok = eq != std::string::npos && static_cast<bool>(std::istringstream(line.substr(eq + 1)) >> value);
+        ok = ok && std::isfinite(value) && value >= 0.0;
+
+        const TunableField* field = nullptr;
+        for (const TunableField& f : TUNABLE_FIELDS)
+            if (name == f.name) field = &f;
+        ok = ok && field && (value > 0.0 || field->zeroAllowed);
+
+        if (!ok || (field->count && value < 1.0))
+        {
+            std::printf("config: %s:%d: cannot use '%s'\n", path.c_str(), lineNumber, line.c_str());
+            continue;
+        }
+        if (field->real) t.*field->real = static_cast<float>(value);
+        else t.*field->count = static_cast<size_t>(value);
+        ++count;
+    }
+    return count;
+}
+
+// Reports a file whose modification time moved since the last poll; the first
+// poll of an existing file counts as a change.
+struct ConfigWatcher
+{
+    std::filesystem::path path;
+    std::filesystem::file_time_type stamp{};
+    bool seen = false;
+
+    bool changed()
+    {
+        std::error_code ec;
+        auto t = std::filesystem::last_write_time(path, ec);
+        if (ec || (seen && t == stamp)) return false;
+        stamp = t;
+        seen = true;
+        return true;
+    }
+};
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+#include "Kepler.h"
+#include "Physics.h"
+
+// State covariance by the unscented transform: 2n+1 sigma points of the 4-D
+// state (x, y, vx, vy) go through the physics step kernel as one small batch
+// and are recombined into a mean and covariance. Scaled UT with alpha = 1,
+// beta = 2, kappa = 0: the centre point only enters the covariance, and the
+// other eight sit two standard deviations out along the Cholesky columns.
+
+const int UT_DIM = 4;
+const int UT_POINTS = 2 * UT_DIM + 1;
+const double UT_ALPHA = 1.0;
+const double UT_BETA = 2.0;
+const double UT_KAPPA = 0.0;
+const int UT_MAX_STEPS = 4096;             // longer spans take proportionally larger steps
+
+struct Covariance
+{
+    std::array<double, UT_DIM * UT_DIM> m{};
+
+    double& operator()(int i, int j) { return m[i * UT_DIM + j]; }
+    double operator()(int i, int j) const { return m[i * UT_DIM + j]; }
+
+    static Covariance diagonal(double sigmaPosition, double sigmaVelocity)
+    {
+        Covariance p;
+        p(0, 0) = p(1, 1) = sigmaPosition * sigmaPosition;
+        p(2, 2) = p(3, 3) = sigmaVelocity * sigmaVelocity;
+        return p;
+    }
+};
+
+// Lower-triangular L with L L^T = P. Directions with no variance (or lost to
+// round-off) get a zero column instead of failing.
+inline Covariance cholesky(const Covariance& p)
+{
+    Covariance l;
+    for (int j = 0; j < UT_DIM; ++j)
+    {
+        double d = p(j, j);
+        for (int k = 0; k < j; ++k) d -= l(j, k) * l(j, k);
+        if (d <= 0.0) continue;
+        l(j, j) = std::sqrt(d);
+        for (int i = j + 1; i < UT_DIM; ++i)
+        {
+            double s = p(i, j);
+            for (int k = 0; k < j; ++k) s -= l(i, k) * l(j, k);
+            l(i, j) = s / l(j, j);
+        }
+    }
+    return l;
+}
+
+struct UtWeights
+{
+    double mean0, cov0, other;
+    double spread;                // sigma points sit spread * L columns from the mean
+};
+
+inline UtWeights utWeights()
+{
+    const double lambda = UT_ALPHA * UT_ALPHA * (UT_DIM + UT_KAPPA) - UT_DIM;
+    UtWeights w;
+    w.mean0 = lambda / (UT_DIM + lambda);
+    w.cov0 = w.mean0 + 1.0 - UT_ALPHA * UT_ALPHA + UT_BETA;
+    w.other = 0.5 / (UT_DIM + lambda);
+    w.spread = std::sqrt(UT_DIM + lambda);
+    return w;
+}
+
+// Append the sigma points of (mean, p) to the batch.
+inline void pushSigmaPoints(const KeplerState& mean, const Covariance& p, BodyBatch& batch)
+{
+    const Covariance l = cholesky(p);
+    const double spread = utWeights().spread;
+    const double x[UT_DIM] = { mean.r.x, mean.r.y, mean.v.x, mean.v.y };
+
+    auto push = [&batch](const double* s)
+    {
+        batch.push({ static_cast<float>(s[0]), static_cast<float>(s[1]) }, { static_cast<float>(s[2]), static_cast<float>(s[3]) });
+    };
+
+    push(x);
+    for (int sign : { 1, -1 })
+    {
+        for (int j = 0; j < UT_DIM; ++j)
+        {
+            double s[UT_DIM];
+            for (int i = 0; i < UT_DIM; ++i) s[i] = x[i] + sign * spread * l(i, j);
+            push(s);
+        }
+    }
+}
+
+// Mean and covariance of the sigma points batch[first .. first + UT_POINTS).
+inline void recombine(const BodyBatch& batch, size_t first, KeplerState& mean, Covariance& p)
+{
+    const UtWeights w = utWeights();
+    double pts[UT_POINTS][UT_DIM];
+    double mu[UT_DIM] = {};
+    for (int k = 0; k < UT_POINTS; ++k)
+    {
+        size_t i = first + k;
+        double wk = k == 0 ? w.mean0 : w.other;
+        pts[k][0] = batch.px[i]; pts[k][1] = batch.py[i];
+        pts[k][2] = batch.vx[i]; pts[k][3] = batch.vy[i];
+        for (int d = 0; d < UT_DIM; ++d) mu[d] += wk * pts[k][d];
+    }
+
+    p = Covariance();
+    for (int k = 0; k < UT_POINTS; ++k)
+    {
+        double wk = k == 0 ? w.cov0 : w.other;
+        double dx[UT_DIM];
+        for (int d = 0; d < UT_DIM; ++d) dx[d] = pts[k][d] - mu[d];
+        for (int a = 0; a < UT_DIM; ++a)
+            for (int b = 0; b < UT_DIM; ++b) p(a, b) += wk * dx[a] * dx[b];
+    }
+    mean = { Vec2d(mu[0], mu[1]), Vec2d(mu[2], mu[3]) };
+}
+
+// Position uncertainty at time t: semi-axes of the n-sigma ellipse and the
+// direction of the major axis.
+struct UncertaintyEllipse
+{
+    double t = 0.0;
+    Vec2d center;
+    double major = 0.0, minor = 0.0;
+    double angle = 0.0;
+};
+
+inline UncertaintyEllipse ellipseOf(double t, const KeplerState& mean, const Covariance& p, double sigmas)
+{
+    double a = p(0, 0), b = p(0, 1), c = p(1, 1);
+    double half = 0.5 * (a + c);
+    double root = std::sqrt(0.25 * (a - c) * (a - c) + b * b);
+
+    UncertaintyEllipse e;
+    e.t = t;
+    e.center = mean.r;
+    e.major = sigmas * std::sqrt(std::max(half + root, 0.0));
+    e.minor = sigmas * std::sqrt(std::max(half - root, 0.0));
+    e.angle = 0.5 * std::atan2(2.0 * b, a - c);
+    return e;
+}
+
+// Carry (mean, p) forward by duration with the batch kernel. Positions are
+// relative to the central body (force.center is ignored). The run starts at
+// t0; third bodies, if given, are sampled at the start of every step. If
+// samples is given, an ellipse is recorded every sampleEvery; the run stops
+// early once the mean passes below surfaceRadius.
+inline void propagateUnscented(ForceModel force, const ThirdBodies* tides, KeplerState& mean, Covariance& p,
+    double duration, double dt, double t0 = 0.0, double sampleEvery = 0.0, double sigmas = 1.0,
+    std::vector<UncertaintyEllipse>* samples = nullptr, double surfaceRadius = 0.0)
+{
+    if (!(duration > 0.0)) return;
+    force.center = { 0.f, 0.f };
+
+    int steps = std::clamp(static_cast<int>(std::ceil(duration / dt)), 1, UT_MAX_STEPS);
+    dt = duration / steps;
+
+    BodyBatch batch;
+    pushSigmaPoints(mean, p, batch);
+    double nextSample = sampleEvery;
+
+    for (int step = 1; step <= steps; ++step)
+    {
+        if (tides) force.bodies = tides->at(t0 + (step - 1) * dt);
+        stepBatch(force, batch, static_cast<float>(dt));
+        double t = step * dt;
+        if (!samples || t < nextSample) continue;
+
+        recombine(batch, 0, mean, p);
+        if (norm(mean.r) < surfaceRadius) return;
+        samples->push_back(ellipseOf(t0 + t, mean, p, sigmas));
+        nextSample += sampleEvery;
+    }
+    recombine(batch, 0, mean, p);
+}
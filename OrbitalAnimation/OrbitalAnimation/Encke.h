@@ -0,0 +1,101 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+#include "Kepler.h"
+
+// Encke propagation: integrate only the deviation d = r - rho from a reference
+// conic rho(t) that is advanced analytically. Because the deviation is driven
+// by the (small) perturbation alone, steps can be a sizeable fraction of an
+// orbit. Battin's f(q) keeps the differential gravity free of cancellation:
+//
+//     d'' = -(mu / rho^3) (d + f(q) r) + P,    q = d.(d - 2r) / r^2
+//
+// When |d| grows past ENCKE_RECTIFY * |rho| the reference is re-osculated.
+
+const int ENCKE_STEPS_PER_REV = 32;
+const double ENCKE_RECTIFY = 1e-2;
+
+struct EnckeState
+{
+    KeplerState reference;        // osculating conic at referenceEpoch
+    double referenceEpoch = 0.0;
+    Vec2d dr, dv;                 // deviation from the reference at t
+    double t = 0.0;
+    int rectifications = 0;
+};
+
+inline EnckeState startEncke(const KeplerState& s, double t)
+{
+    EnckeState e;
+    e.reference = s;
+    e.referenceEpoch = t;
+    e.t = t;
+    return e;
+}
+
+inline KeplerState enckeReference(const EnckeState& e, double t, double mu)
+{
+    return keplerPropagate(e.reference, t - e.referenceEpoch, mu);
+}
+
+// Full state at any time near e.t: exact reference plus the deviation carried
+// forward linearly (the deviation varies slowly compared to the orbit).
+inline KeplerState enckeState(const EnckeState& e, double t, double mu)
+{
+    KeplerState rho = enckeReference(e, t, mu);
+    return { rho.r + e.dr + e.dv * (t - e.t), rho.v + e.dv };
+}
+
+// A fixed fraction of the reference period (or of the flyby time scale if unbound).
+inline double enckeStep(const EnckeState& e, double mu)
+{
+    return orbitTimescale(enckeState(e, e.t, mu), mu) / ENCKE_STEPS_PER_REV;
+}
+
+inline double enckeF(double q)
+{
+    double s = std::sqrt(1.0 + q);
+    return q * (3.0 + 3.0 * q + q * q) / (1.0 + s * s * s);
+}
+
+// RK4 on the deviation. perturb(r, v) is the non-Keplerian acceleration.
+template <typename Perturbation>
+inline void stepEncke(EnckeState& e, double h, double mu, const Perturbation& perturb)
+{
+    auto accel = [&](const KeplerState& rho, Vec2d dr, Vec2d dv)
+    {
+        Vec2d r = rho.r + dr;
+        double rr = dot(r, r);
+        double q = dot(dr, dr - r * 2.0) / rr;
+        double rho1 = norm(rho.r);
+        return (dr + r * enckeF(q)) * (-mu / (rho1 * rho1 * rho1)) + perturb(r, rho.v + dv);
+    };
+
+    KeplerState rho0 = enckeReference(e, e.t, mu);
+    KeplerState rhoMid = enckeReference(e, e.t + 0.5 * h, mu);
+    KeplerState rho1 = enckeReference(e, e.t + h, mu);
+
+    Vec2d k1r = e.dv;
+    Vec2d k1v = accel(rho0, e.dr, e.dv);
+    Vec2d k2r = e.dv + k1v * (0.5 * h);
+    Vec2d k2v = accel(rhoMid, e.dr + k1r * (0.5 * h), k2r);
+    Vec2d k3r = e.dv + k2v * (0.5 * h);
+    Vec2d k3v = accel(rhoMid, e.dr + k2r * (0.5 * h), k3r);
+    Vec2d k4r = e.dv + k3v * h;
+    Vec2d k4v = accel(rho1, e.dr + k3r * h, k4r);
+
+    e.dr += (k1r + k2r * 2.0 + k3r * 2.0 + k4r) * (h / 6.0);
+    e.dv += (k1v + k2v * 2.0 + k3v * 2.0 + k4v) * (h / 6.0);
+    e.t += h;
+
+    if (norm(e.dr) > ENCKE_RECTIFY * norm(rho1.r))
+    {
+        e.reference = { rho1.r + e.dr, rho1.v + e.dv };
+        e.referenceEpoch = e.t;
+        e.dr = {};
+        e.dv = {};
+        ++e.rectifications;
+    }
+}
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "Kepler.h"
+#include "Parallel.h"
+#include "Physics.h"
+
+// Monte Carlo dispersion ensemble, run headless. Member k's perturbation comes
+// from a counter-based generator keyed by (seed, k), so results do not depend
+// on how members are split across threads. Members are stepped in SoA batches
+// with the physics kernel and each outcome is folded into running statistics
+// as it happens; nothing per member outlives its batch.
+
+const size_t ENSEMBLE_BATCH = 2048;        // members stepped together per thread
+const int ENSEMBLE_BINS = 20;              // re-entry time histogram over the run
+
+// Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3").
+inline std::array<uint32_t, 4> philox4x32(std::array<uint32_t, 4> c, std::array<uint32_t, 2> k)
+{
+    for (int round = 0; round < 10; ++round)
+    {
+        uint64_t p0 = uint64_t(0xD2511F53u) * c[0];
+        uint64_t p1 = uint64_t(0xCD9E8D57u) * c[2];
+        c = {
+            uint32_t(p1 >> 32) ^ c[1] ^ k[0], uint32_t(p1),
+            uint32_t(p0 >> 32) ^ c[3] ^ k[1], uint32_t(p0)
+        };
+        k[0] += 0x9E3779B9u;
+        k[1] += 0xBB67AE85u;
+    }
+    return c;
+}
+
+// One Philox word as a uniform in (0, 1); never 0, so it is safe under log.
+inline double uniform01(uint32_t u)
+{
+    return (static_cast<double>(u) + 0.5) * (1.0 / 4294967296.0);
+}
+
+// Four standard normals for member index k (Box-Muller on one Philox block).
+inline std::array<double, 4> memberNormals(uint64_t k, uint64_t seed)
+{
+    auto bits = philox4x32({ uint32_t(k), uint32_t(k >> 32), 0u, 0u }, { uint32_t(seed), uint32_t(seed >> 32) });
+    std::array<double, 4> n;
+    for (int i = 0; i < 4; i += 2)
+    {
+        double radius = std::sqrt(-2.0 * std::log(uniform01(bits[i])));
+        double angle = 2.0 * KEPLER_PI * uniform01(bits[i + 1]);
+        n[i] = radius * std::cos(angle);
+        n[i + 1] = radius * std::sin(angle);
+    }
+    return n;
+}
+
+struct EnsembleSpec
+{
+    KeplerState base;             // relative to the central body
+    double sigmaPosition = 1.0;   // per axis
+    double sigmaVelocity = 0.01;
+    double duration = 60.0;
+    double dt = 1.0 / 256.0;
+    uint64_t members = 1000;
+    uint64_t seed = 1;
+    double surfaceRadius = 0.0;   // below: re-entry
+    double escapeRadius = 1e9;    // beyond: escaped, no longer followed
+};
+
+// Streaming mean/variance (Welford) that merges across threads (Chan et al.).
+struct RunningStat
+{
+    uint64_t n = 0;
+    double mean = 0.0, m2 = 0.0;
+    double lo = 1e300, hi = -1e300;
+
+    void add(double x)
+    {
+        ++n;
+        double d = x - mean;
+        mean += d / static_cast<double>(n);
+        m2 += d * (x - mean);
+        lo = std::min(lo, x);
+        hi = std::max(hi, x);
+    }
+
+    void merge(const RunningStat& o)
+    {
+        if (o.n == 0) return;
+        uint64_t total = n + o.n;
+        double d = o.mean - mean;
+        mean += d * static_cast<double>(o.n) / static_cast<double>(total);
+        m2 += o.m2 + d * d * static_cast<double>(n) * static_cast<double>(o.n) / static_cast<double>(total);
+        n = total;
+        lo = std::min(lo, o.lo);
+        hi = std::max(hi, o.hi);
+    }
+
+    double stddev() const { return n > 1 ? std::sqrt(m2 / static_cast<double>(n - 1)) : 0.0; }
+};
+
+struct EnsembleStats
+{
+    uint64_t members = 0;
+    uint64_t reentered = 0, escaped = 0, survived = 0;
+    RunningStat reentryTime;
+    RunningStat finalRadius;      // survivors at the end of the run
+    std::array<uint64_t, ENSEMBLE_BINS> reentryHistogram{};
+    double milliseconds = 0.0;
+
+    void merge(const EnsembleStats& o)
+    {
+        members += o.members;
+        reentered += o.reentered;
+        escaped += o.escaped;
+        survived += o.survived;
+        reentryTime.merge(o.reentryTime);
+        finalRadius.merge(o.finalRadius);
+        for (int b = 0; b < ENSEMBLE_BINS; ++b) reentryHistogram[b] += o.reentryHistogram[b];
+    }
+};
+
+// Step members [first, first + count) to the end of the run or their outcome.
+inline void runEnsembleBatch(const EnsembleSpec& spec, const ForceModel& force, uint64_t first, size_t count,
+    BodyBatch& batch, EnsembleStats& stats)
+{
+    batch.clear();
+    for (size_t i = 0; i < count; ++i)
+    {
+        std::array<double, 4> n = memberNormals(first + i, spec.seed);
+        Vec2d r = spec.base.r + Vec2d(n[0], n[1]) * spec.sigmaPosition;
+        Vec2d v = spec.base.v + Vec2d(n[2], n[3]) * spec.sigmaVelocity;
+        batch.push({ static_cast<float>(r.x), static_cast<float>(r.y) }, { static_cast<float>(v.x), static_cast<float>(v.y) });
+    }
+    stats.members += count;
+
+    const float surface2 = static_cast<float>(spec.surfaceRadius * spec.surfaceRadius);
+    const float escape2 = static_cast<float>(spec.escapeRadius * spec.escapeRadius);
+    const int steps = static_cast<int>(std::ceil(spec.duration / spec.dt));
+
+    for (int step = 1; step <= steps && batch.size() > 0; ++step)
+    {
+        stepBatch(force, batch, static_cast<float>(spec.dt));
+        double t = step * spec.dt;
+
+        // retire finished members by swapping the last one into their slot
+        for (size_t i = batch.size(); i-- > 0;)
+        {
+            float r2 = batch.px[i] * batch.px[i] + batch.py[i] * batch.py[i];
+            if (r2 > surface2 && r2 < escape2) continue;
+
+            if (r2 <= surface2)
+            {
+                ++stats.reentered;
+                stats.reentryTime.add(t);
+                int bin = std::min(static_cast<int>(t / spec.duration * ENSEMBLE_BINS), ENSEMBLE_BINS - 1);
+                ++stats.reentryHistogram[bin];
+            }
+            else
+            {
+                ++stats.escaped;
+            }
+
+            for (std::vector<float>* a : { &batch.px, &batch.py, &batch.vx, &batch.vy })
+            {
+                (*a)[i] = a->back();
+                a->pop_back();
+            }
+        }
+    }
+
+    for (size_t i = 0; i < batch.size(); ++i)
+    {
+        ++stats.survived;
+        stats.finalRadius.add(std::sqrt(batch.px[i] * batch.px[i] + batch.py[i] * batch.py[i]));
+    }
+}
+
+// force.center is ignored: members are stepped relative to the central body.
+inline EnsembleStats runEnsemble(const EnsembleSpec& spec, ForceModel force, unsigned threads)
+{
+    auto start = std::chrono::steady_clock::now();
+    force.center = { 0.f, 0.f };
+
+    std::vector<BodyBatch> batches(parallelWorkers(threads));
+    std::vector<EnsembleStats> locals(parallelWorkers(threads));
+    parallelFor(static_cast<size_t>(spec.members), ENSEMBLE_BATCH, threads, "ensemble", [&](size_t first, size_t last, unsigned worker)
+    {
+        runEnsembleBatch(spec, force, first, last - first, batches[worker], locals[worker]);
+    });
+
+    EnsembleStats total;
+    for (const EnsembleStats& local : locals) total.merge(local);
+    total.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return total;
+}
+
+inline void printEnsemble(const EnsembleSpec& spec, const EnsembleStats& s)
+{
+    auto fraction = [&s](uint64_t k) { return s.members ? static_cast<double>(k) / static_cast<double>(s.members) : 0.0; };
+    double p = fraction(s.reentered);
+    double standardError = s.members ? std::sqrt(p * (1.0 - p) / static_cast<double>(s.members)) : 0.0;
+
+    std::printf("ensemble %llu members, %.1f s at dt %.5f, seed %llu: %.0f ms (%.0f members/s)\n",
+        static_cast<unsigned long long>(s.members), spec.duration, spec.dt, static_cast<unsigned long long>(spec.seed),
+        s.milliseconds, s.milliseconds > 0.0 ? 1000.0 * static_cast<double>(s.members) / s.milliseconds : 0.0);
+    std::printf("  re-entry  %.4f +- %.4f  (%llu)\n", p, standardError, static_cast<unsigned long long>(s.reentered));
+    std::printf("  escape    %.4f  (%llu)\n", fraction(s.escaped), static_cast<unsigned long long>(s.escaped));
+    std::printf("  survive   %.4f  (%llu)\n", fraction(s.survived), static_cast<unsigned long long>(s.survived));
+    if (s.reentryTime.n)
+    {
+        std::printf("  re-entry time mean %.3f sd %.3f [%.3f %.3f]\n",
+            s.reentryTime.mean, s.reentryTime.stddev(), s.reentryTime.lo, s.reentryTime.hi);
+        std::printf("  re-entry time histogram (%d bins over the run):", ENSEMBLE_BINS);
+        for (uint64_t c : s.reentryHistogram) std::printf(" %llu", static_cast<unsigned long long>(c));
+        std::printf("\n");
+    }
+    if (s.finalRadius.n)
+    {
+        std::printf("  final radius mean %.2f sd %.2f [%.2f %.2f]\n",
+            s.finalRadius.mean, s.finalRadius.stddev(), s.finalRadius.lo, s.finalRadius.hi);
+    }
+}
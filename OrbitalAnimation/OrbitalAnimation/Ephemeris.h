@@ -0,0 +1,332 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Events.h"
+#include "Kepler.h"
+#include "Physics.h"
+#include "Trace.h"
+
+// Compressed ephemerides: a satellite's future trajectory as piecewise
+// Chebyshev series over fixed windows, fitted on a background thread. Any
+// position/velocity inside the horizon is then a Clenshaw evaluation.
+
+const int EPHEM_DEGREE = 12;              // per window and axis: 13 float coefficients
+const int EPHEM_WINDOWS_PER_REV = 2;
+const float EPHEM_HORIZON_REVS = 2.f;
+const double EPHEM_MAX_HORIZON = 120.0;   // cap for slow and unbound orbits
+const double EPHEM_MAX_STEP = 0.01;       // RK4 step used while fitting
+const double EPHEM_REFIT_FRACTION = 0.25; // refit once this much of the horizon remains
+
+struct ChebyshevWindow
+{
+    std::array<float, EPHEM_DEGREE + 1> cx;
+    std::array<float, EPHEM_DEGREE + 1> cy;
+};
+
+struct Ephemeris
+{
+    double start = 0.0;
+    double window = 1.0;          // duration of each window
+    bool impact = false;          // trajectory ends on the central body at end()
+    std::vector<ChebyshevWindow> windows;
+
+    double end() const { return start + window * static_cast<double>(windows.size()); }
+    bool covers(double t) const { return t >= start && t <= end(); }
+
+    // Position relative to the central body. t must be covered.
+    Vec2d position(double t) const
+    {
+        const ChebyshevWindow* w;
+        double x = localTime(t, w);
+        return { clenshaw(w->cx, x), clenshaw(w->cy, x) };
+    }
+
+    Vec2d velocity(double t) const
+    {
+        const ChebyshevWindow* w;
+        double x = localTime(t, w);
+        double scale = 2.0 / window;
+        return { clenshawDerivative(w->cx, x) * scale, clenshawDerivative(w->cy, x) * scale };
+    }
+
+    size_t bytes() const { return windows.size() * sizeof(ChebyshevWindow); }
+
+private:
+    double localTime(double t, const ChebyshevWindow*& w) const
+    {
+        double u = (t - start) / window;
+        size_t i = std::min(static_cast<size_t>(std::max(u, 0.0)), windows.size() - 1);
+        w = &windows[i];
+        return 2.0 * (u - static_cast<double>(i)) - 1.0;
+    }
+
+    static double clenshaw(const std::array<float, EPHEM_DEGREE + 1>& c, double x)
+    {
+        double b1 = 0.0, b2 = 0.0;
+        for (int j = EPHEM_DEGREE; j >= 1; --j)
+        {
+            double b0 = 2.0 * x * b1 - b2 + c[j];
+            b2 = b1;
+            b1 = b0;
+        }
+        return x * b1 - b2 + c[0];
+    }
+
+    // d/dx of the series via the U-polynomial recurrence: T_j' = j U_{j-1}
+    static double clenshawDerivative(const std::array<float, EPHEM_DEGREE + 1>& c, double x)
+    {
+        double b1 = 0.0, b2 = 0.0;
+        for (int j = EPHEM_DEGREE; j >= 1; --j)
+        {
+            double b0 = 2.0 * x * b1 - b2 + j * c[j];
+            b2 = b1;
+            b1 = b0;
+        }
+        return b1;
+    }
+};
+
+// Integrates the force model from s0 (relative to the center) over the
+// horizon, then fits equal windows from samples at their Chebyshev nodes.
+// Windows are short enough to resolve periapsis passage, and the horizon ends
+// at the exact surface contact if the trajectory reaches it. Third bodies,
+// if given, are sampled at the start of every step, on the clock t0 is read on.
+inline Ephemeris fitEphemeris(const KeplerState& s0, double t0, const ForceModel& force, const ThirdBodies* tides,
+    double surfaceRadius)
+{
+    const int nodes = EPHEM_DEGREE + 1;
+    const double mu = force.mu;
+
+    ConicBounds bounds = conicBounds(s0, mu);
+    double period = orbitTimescale(s0, mu);
+    double horizon = std::min(period * (bounds.bound ? EPHEM_HORIZON_REVS : 1.0), EPHEM_MAX_HORIZON);
+
+    // time scale of periapsis passage: 2 pi rp / vp with vp = h / rp
+    double h = std::abs(cross(s0.r, s0.v));
+    double periapsisScale = h > 0.0 ? 2.0 * KEPLER_PI * bounds.periapsis * bounds.periapsis / h : period;
+    double nominalWindow = std::min(period, periapsisScale) / EPHEM_WINDOWS_PER_REV;
+
+    ForceModel f = force;
+    auto rk4 = [&f](KeplerState& s, double dt)
+    {
+        Vec2d k1v = accelerationAt(f, s.r, s.v), k1r = s.v;
+        Vec2d k2r = s.v + k1v * (0.5 * dt), k2v = accelerationAt(f, s.r + k1r * (0.5 * dt), k2r);
+        Vec2d k3r = s.v + k2v * (0.5 * dt), k3v = accelerationAt(f, s.r + k2r * (0.5 * dt), k3r);
+        Vec2d k4r = s.v + k3v * dt, k4v = accelerationAt(f, s.r + k3r * dt, k4r);
+        s.r += (k1r + k2r * 2.0 + k3r * 2.0 + k4r) * (dt / 6.0);
+        s.v += (k1v + k2v * 2.0 + k3v * 2.0 + k4v) * (dt / 6.0);
+    };
+
+    // dense pass at a fixed step; nodes are read back by cubic Hermite interpolation
+    Ephemeris e;
+    e.start = t0;
+    const double step = EPHEM_MAX_STEP;
+    std::vector<KeplerState> dense;
+    dense.reserve(static_cast<size_t>(horizon / step) + 2);
+    dense.push_back(s0);
+    KeplerState s = s0;
+    const EventSpec surface = { surfaceRadius, {}, false };
+    std::vector<OrbitEvent> contact;
+    double span = 0.0;
+    while (span < horizon)
+    {
+        KeplerState prev = s;
+        if (tides) f.bodies = tides->at(t0 + span);
+        rk4(s, step);
+        dense.push_back(s);
+        if (detectEvents({ span, span + step, prev, s }, surface, contact))
+        {
+            // the last dense step runs below the surface; windows stop at contact
+            e.impact = true;
+            span = contact.back().t;
+            break;
+        }
+        span += step;
+    }
+
+    size_t windowCount = std::max<size_t>(1, static_cast<size_t>(std::ceil(span / nominalWindow)));
+    e.window = span / static_cast<double>(windowCount);
+    e.windows.reserve(windowCount);
+
+    auto sample = [&dense, step](double t) -> Vec2d
+    {
+        size_t i = std::min(static_cast<size_t>(std::max(t / step, 0.0)), dense.size() - 2);
+        double ti = static_cast<double>(i) * step;
+        return DenseStep{ ti, ti + step, dense[i], dense[i + 1] }.at(t).r;
+    };
+
+    for (size_t w = 0; w < windowCount; ++w)
+    {
+        // Chebyshev-Gauss nodes x_k = cos(pi (k + 1/2) / n) and the DCT onto T_0..T_N
+        std::array<Vec2d, nodes> samples;
+        for (int k = 0; k < nodes; ++k)
+        {
+            double x = std::cos(KEPLER_PI * (k + 0.5) / nodes);
+            samples[k] = sample(e.window * (static_cast<double>(w) + 0.5 * (x + 1.0)));
+        }
+
+        ChebyshevWindow cw;
+        for (int j = 0; j < nodes; ++j)
+        {
+            double sx = 0.0, sy = 0.0;
+            for (int k = 0; k < nodes; ++k)
+            {
+                double c = std::cos(KEPLER_PI * j * (k + 0.5) / nodes);
+                sx += samples[k].x * c;
+                sy += samples[k].y * c;
+            }
+            double scale = (j == 0 ? 1.0 : 2.0) / nodes;
+            cw.cx[j] = static_cast<float>(sx * scale);
+            cw.cy[j] = static_cast<float>(sy * scale);
+        }
+        e.windows.push_back(cw);
+    }
+
+    return e;
+}
+
+// Background fitter plus the latest ephemeris per satellite id. Queries take
+// the lock only long enough to copy a shared_ptr.
+struct EphemerisCache
+{
+    struct Job
+    {
+        uint32_t id;
+        KeplerState state;
+        double epoch;
+        uint32_t generation;
+    };
+
+    struct Entry
+    {
+        std::shared_ptr<const Ephemeris> ephemeris;
+        uint32_t generation = 0;
+        bool pending = false;
+    };
+
+    ForceModel force;
+    std::shared_ptr<const ThirdBodies> tides;     // null while the tides are off
+    double surfaceRadius;
+
+    std::mutex mutex;
+    std::condition_variable wakeWorker;
+    std::deque<Job> jobs;
+    std::unordered_map<uint32_t, Entry> entries;
+    std::jthread worker;
+
+    EphemerisCache(const ForceModel& f, double surface)
+        : force(f), surfaceRadius(surface), worker([this](std::stop_token stop) { run(stop); })
+    {
+    }
+
+    ~EphemerisCache()
+    {
+        {
+            // under the mutex, so the worker cannot test the predicate and then miss the wakeup
+            std::lock_guard<std::mutex> lock(mutex);
+            worker.request_stop();
+        }
+        wakeWorker.notify_all();
+    }
+
+    std::shared_ptr<const Ephemeris> find(uint32_t id)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(id);
+        return it == entries.end() ? nullptr : it->second.ephemeris;
+    }
+
+    // Queue a refit from this state unless the cached one still has enough
+    // horizon left or a fit is already in flight.
+    void refresh(uint32_t id, const KeplerState& state, double epoch)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Entry& entry = entries[id];
+        if (entry.pending) return;
+        if (entry.ephemeris)
+        {
+            const Ephemeris& e = *entry.ephemeris;
+            if (epoch >= e.start && epoch < e.end() - EPHEM_REFIT_FRACTION * (e.end() - e.start)) return;
+        }
+        entry.pending = true;
+        jobs.push_back({ id, state, epoch, entry.generation });
+        wakeWorker.notify_one();
+    }
+
+    // The trajectory changed (e.g. a maneuver): drop the fit and any in-flight result.
+    void invalidate(uint32_t id)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(id);
+        if (it == entries.end()) return;
+        it->second.ephemeris.reset();
+        it->second.pending = false;
+        ++it->second.generation;
+    }
+
+    // The force itself changed (or the tides came on or off): every fit is
+    // stale. Jobs already queued are dropped by the generation check and
+    // refitted on the next refresh.
+    void setForce(const ForceModel& f, std::shared_ptr<const ThirdBodies> t)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        force = f;
+        tides = std::move(t);
+        for (auto& item : entries)
+        {
+            item.second.ephemeris.reset();
+            item.second.pending = false;
+            ++item.second.generation;
+        }
+    }
+
+    void forget(uint32_t id)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.erase(id);
+    }
+
+    void run(std::stop_token stop)
+    {
+        nameTraceThread("ephemeris");
+        while (!stop.stop_requested())
+        {
+            Job job;
+            ForceModel f;
+            std::shared_ptr<const ThirdBodies> t;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeWorker.wait(lock, [&] { return stop.stop_requested() || !jobs.empty(); });
+                if (stop.stop_requested()) return;
+                job = jobs.front();
+                jobs.pop_front();
+                f = force;
+                t = tides;
+            }
+
+            std::shared_ptr<const Ephemeris> fitted;
+            {
+                TraceScope trace("fit ephemeris");
+                fitted = std::make_shared<const Ephemeris>(fitEphemeris(job.state, job.epoch, f, t.get(), surfaceRadius));
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = entries.find(job.id);
+            if (it == entries.end() || it->second.generation != job.generation) continue;
+            it->second.ephemeris = std::move(fitted);
+            it->second.pending = false;
+        }
+    }
+};
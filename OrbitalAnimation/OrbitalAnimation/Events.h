@@ -0,0 +1,215 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "Kepler.h"
+
+// Event detection on integrator steps. The states at both ends of a step give
+// a cubic Hermite dense output; event functions are bracketed on it and their
+// roots refined with Brent's method, so events fire at their actual time
+// instead of on the step (or frame) boundary.
+//
+// Radius events are only tested between radial extrema (roots of r.v), where
+// |r| is monotone, so a fast body cannot skim below the surface and back out
+// within one step unnoticed.
+
+const double EVENT_TIME_TOL = 1e-7;
+const int EVENT_MAX_ITERATIONS = 60;
+
+enum class EventKind
+{
+    Impact,
+    Periapsis,
+    Apoapsis,
+    Threshold       // crossed one of EventSpec::thresholds
+};
+
+struct OrbitEvent
+{
+    EventKind kind = EventKind::Impact;
+    double t = 0.0;
+    KeplerState state;            // relative to the central body, at t
+    uint32_t body = 0;            // filled in by the caller
+    int threshold = -1;           // index into EventSpec::thresholds
+    bool inward = false;          // threshold crossed on the way down
+};
+
+struct EventSpec
+{
+    double surfaceRadius = 0.0;
+    std::vector<double> thresholds;   // radii
+    bool apsides = true;
+};
+
+// Cubic Hermite interpolant of one step, t in [t0, t1].
+struct DenseStep
+{
+    double t0 = 0.0, t1 = 0.0;
+    KeplerState a, b;
+
+    KeplerState at(double t) const
+    {
+        double h = t1 - t0;
+        double x = h > 0.0 ? (t - t0) / h : 0.0;
+        double x2 = x * x, x3 = x2 * x;
+        KeplerState s;
+        s.r = a.r * (2 * x3 - 3 * x2 + 1) + a.v * ((x3 - 2 * x2 + x) * h)
+            + b.r * (-2 * x3 + 3 * x2) + b.v * ((x3 - x2) * h);
+        s.v = h > 0.0
+            ? (a.r * (6 * x2 - 6 * x) + b.r * (6 * x - 6 * x2)) / h
+                + a.v * (3 * x2 - 4 * x + 1) + b.v * (3 * x2 - 2 * x)
+            : a.v;
+        return s;
+    }
+};
+
+// Brent's method on a bracket with f(a), f(b) of opposite sign (Numerical Recipes, zbrent).
+template <typename F>
+inline double brentRoot(const F& f, double a, double b, double fa, double fb, double tol = EVENT_TIME_TOL)
+{
+    if (fa == 0.0) return a;
+    if (fb == 0.0) return b;
+
+    double c = b, fc = fb, d = b - a, e = d;
+    for (int it = 0; it < EVENT_MAX_ITERATIONS; ++it)
+    {
+        if ((fb > 0.0) == (fc > 0.0))
+        {
+            c = a; fc = fa;
+            d = e = b - a;
+        }
+        if (std::abs(fc) < std::abs(fb))
+        {
+            a = b; b = c; c = a;
+            fa = fb; fb = fc; fc = fa;
+        }
+
+        double tol1 = 4e-16 * std::abs(b) + 0.5 * tol;
+        double m = 0.5 * (c - b);
+        if (std::abs(m) <= tol1 || fb == 0.0) return b;
+
+        if (std::abs(e) >= tol1 && std::abs(fa) > std::abs(fb))
+        {
+            // inverse quadratic interpolation, or secant when only two points are distinct
+            double s = fb / fa, p, q;
+            if (a == c)
+            {
+                p = 2.0 * m * s;
+                q = 1.0 - s;
+            }
+            else
+            {
+                double qa = fa / fc, r = fb / fc;
+                p = s * (2.0 * m * qa * (qa - r) - (b - a) * (r - 1.0));
+                q = (qa - 1.0) * (r - 1.0) * (s - 1.0);
+            }
+            if (p > 0.0) q = -q;
+            p = std::abs(p);
+
+            if (2.0 * p < std::min(3.0 * m * q - std::abs(tol1 * q), std::abs(e * q)))
+            {
+                e = d;
+                d = p / q;
+            }
+            else
+            {
+                d = m;
+                e = d;
+            }
+        }
+        else
+        {
+            d = m;
+            e = d;
+        }
+
+        a = b;
+        fa = fb;
+        b += std::abs(d) > tol1 ? d : (m > 0.0 ? tol1 : -tol1);
+        fb = f(b);
+    }
+    return b;
+}
+
+// Append the events inside one step to out, in time order. Returns true if the
+// step hits the surface; out.back() is then the impact and nothing after it is
+// reported.
+inline bool detectEvents(const DenseStep& step, const EventSpec& spec, std::vector<OrbitEvent>& out)
+{
+    const size_t first = out.size();
+    auto radialRate = [&step](double t) { KeplerState s = step.at(t); return dot(s.r, s.v); };
+    auto radius = [&step](double t) { return norm(step.at(t).r); };
+
+    // radial extrema, sampled at the midpoint too so both apsides of a long step are seen
+    std::array<double, 4> cuts = { step.t0 };
+    int cutCount = 1;
+    const double tm = 0.5 * (step.t0 + step.t1);
+    const std::array<double, 3> probes = { step.t0, tm, step.t1 };
+    double g0 = radialRate(probes[0]);
+    for (int k = 1; k < 3; ++k)
+    {
+        double g1 = radialRate(probes[k]);
+        if ((g0 < 0.0) != (g1 < 0.0))
+        {
+            double te = brentRoot(radialRate, probes[k - 1], probes[k], g0, g1);
+            cuts[cutCount++] = te;
+            if (spec.apsides)
+            {
+                OrbitEvent e;
+                e.kind = g0 < 0.0 ? EventKind::Periapsis : EventKind::Apoapsis;
+                e.t = te;
+                e.state = step.at(te);
+                out.push_back(e);
+            }
+        }
+        g0 = g1;
+    }
+    cuts[cutCount++] = step.t1;
+
+    // |r| is monotone on each piece, so one sign test per level is exact
+    bool impact = false;
+    for (int k = 0; k + 1 < cutCount && !impact; ++k)
+    {
+        double ta = cuts[k], tb = cuts[k + 1];
+        double ra = radius(ta), rb = radius(tb);
+
+        for (int j = 0; j < static_cast<int>(spec.thresholds.size()); ++j)
+        {
+            double level = spec.thresholds[j];
+            if ((ra > level) == (rb > level)) continue;
+            auto f = [&radius, level](double t) { return radius(t) - level; };
+            OrbitEvent e;
+            e.kind = EventKind::Threshold;
+            e.t = brentRoot(f, ta, tb, ra - level, rb - level);
+            e.state = step.at(e.t);
+            e.threshold = j;
+            e.inward = rb < ra;
+            out.push_back(e);
+        }
+
+        if (ra > spec.surfaceRadius && rb <= spec.surfaceRadius)
+        {
+            auto f = [&radius, &spec](double t) { return radius(t) - spec.surfaceRadius; };
+            OrbitEvent e;
+            e.kind = EventKind::Impact;
+            e.t = brentRoot(f, ta, tb, ra - spec.surfaceRadius, rb - spec.surfaceRadius);
+            e.state = step.at(e.t);
+            out.push_back(e);
+            impact = true;
+        }
+    }
+
+    std::sort(out.begin() + static_cast<long>(first), out.end(),
+        [](const OrbitEvent& x, const OrbitEvent& y) { return x.t < y.t; });
+    if (impact)
+    {
+        auto hit = std::find_if(out.begin() + static_cast<long>(first), out.end(),
+            [](const OrbitEvent& e) { return e.kind == EventKind::Impact; });
+        out.erase(hit + 1, out.end());
+    }
+    return impact;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+
+// Adaptive quality. The governor watches how long each frame's work takes and
+// trades detail for time when it runs over the target. Frame work is every
+// phase but present (which sleeps for the frame limiter), with physics
+// counted at one substep: the time warp fills whatever is left and signals
+// pressure of its own when that is not enough. Detail moves along a table of
+// levels, each at most twice as cheap as the one before. Hysteresis keeps it
+// from oscillating: it coarsens after a short run of frames over the target,
+// refines only after a long run under half of it (where the finer level still
+// fits), and holds still after every change so the smoothed time can settle.
+
+const float QUALITY_TARGET_MS = 1000.f / 60.f;
+const float QUALITY_HIGH = 0.9f;          // coarsen above this fraction of the target
+const float QUALITY_LOW = 0.5f;           // refine below it
+const int QUALITY_DOWN_FRAMES = 10;       // frames over before coarsening
+const int QUALITY_UP_FRAMES = 120;        // frames under before refining
+const int QUALITY_HOLD_FRAMES = 45;       // no change for this long after one
+
+struct QualityLevel
+{
+    int predictDivisor;           // ghost path: same span, this many times fewer steps
+    float trailFraction;          // of MAX_TRAIL kept per satellite
+    int trailStride;              // one trail sample kept in this many
+    int markerSegments;           // line segments per uncertainty ellipse
+    float renderScale;            // world drawn at this fraction of the window resolution
+};
+
+const QualityLevel QUALITY_LEVELS[] = {
+    { 1, 1.f, 1, 32, 1.f },
+    { 2, 1.f, 2, 24, 1.f },
+    { 4, 0.5f, 2, 16, 1.f },
+    { 4, 0.5f, 4, 12, 0.75f },
+    { 8, 0.25f, 4, 8, 0.75f },
+    { 8, 0.25f, 8, 8, 0.5f },
+};
+
+const int QUALITY_LEVEL_COUNT = static_cast<int>(std::size(QUALITY_LEVELS));
+
+struct QualityGovernor
+{
+    bool enabled = true;
+    int level = 0;
+    float smoothedMs = 0.f;       // frame work, smoothed over recent frames
+    int overFrames = 0, underFrames = 0, hold = 0;
+
+    const QualityLevel& knobs() const { return QUALITY_LEVELS[level]; }
+
+    // Feed one frame's work; pressure (the time warp falling behind) counts as
+    // over the target. Returns true when the level changed.
+    bool update(float workMs, bool pressure)
+    {
+        smoothedMs += (workMs - smoothedMs) * 0.1f;
+        if (!enabled || hold > 0)
+        {
+            hold = std::max(hold - 1, 0);
+            return false;
+        }
+
+        const bool over = pressure || smoothedMs > QUALITY_HIGH * QUALITY_TARGET_MS;
+        const bool under = !pressure && smoothedMs < QUALITY_LOW * QUALITY_TARGET_MS;
+        overFrames = over ? overFrames + 1 : 0;
+        underFrames = under ? underFrames + 1 : 0;
+
+        int next = level;
+        if (overFrames >= QUALITY_DOWN_FRAMES) next = std::min(level + 1, QUALITY_LEVEL_COUNT - 1);
+        else if (underFrames >= QUALITY_UP_FRAMES) next = std::max(level - 1, 0);
+        if (next == level) return false;
+
+        level = next;
+        overFrames = underFrames = 0;
+        hold = QUALITY_HOLD_FRAMES;
+        return true;
+    }
+
+    // Switch the governor on or off; off goes back to full detail.
+    void toggle()
+    {
+        enabled = !enabled;
+        level = 0;
+        overFrames = underFrames = hold = 0;
+    }
+};
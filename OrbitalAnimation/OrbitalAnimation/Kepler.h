@@ -0,0 +1,168 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Analytic two-body propagation. Everything here is relative to the central
+// body and in double precision; callers convert to/from sf::Vector2f.
+
+using Vec2d = sf::Vector2<double>;
+
+const double KEPLER_PI = 3.14159265358979323846;
+
+struct KeplerState
+{
+    Vec2d r;
+    Vec2d v;
+};
+
+inline double dot(Vec2d a, Vec2d b) { return a.x * b.x + a.y * b.y; }
+inline double cross(Vec2d a, Vec2d b) { return a.x * b.y - a.y * b.x; }
+inline double norm(Vec2d a) { return std::sqrt(a.x * a.x + a.y * a.y); }
+
+// Stumpff functions C(z), S(z) of the universal-variable formulation.
+inline void stumpff(double z, double& c, double& s)
+{
+    if (z > 1e-6)
+    {
+        double sz = std::sqrt(z);
+        c = (1.0 - std::cos(sz)) / z;
+        s = (sz - std::sin(sz)) / (sz * sz * sz);
+    }
+    else if (z < -1e-6)
+    {
+        double sz = std::sqrt(-z);
+        c = (std::cosh(sz) - 1.0) / -z;
+        s = (std::sinh(sz) - sz) / (sz * sz * sz);
+    }
+    else
+    {
+        c = 0.5 - z / 24.0 + z * z / 720.0;
+        s = 1.0 / 6.0 - z / 120.0 + z * z / 5040.0;
+    }
+}
+
+// Advance a conic by dt with the universal variable (Vallado, algorithm 8).
+// Works for elliptic, parabolic and hyperbolic orbits and negative dt.
+inline KeplerState keplerPropagate(const KeplerState& s0, double dt, double mu)
+{
+    const double sqrtMu = std::sqrt(mu);
+    const double r0 = norm(s0.r);
+    const double v0sq = dot(s0.v, s0.v);
+    const double rv = dot(s0.r, s0.v);
+    const double alpha = 2.0 / r0 - v0sq / mu;     // 1 / a
+
+    if (dt == 0.0 || r0 <= 0.0) return s0;
+
+    // whole revolutions change nothing; wrapping into half a period either side
+    // keeps chi small and the Newton iteration away from its divergent region
+    if (alpha > 1e-12)
+    {
+        double period = 2.0 * KEPLER_PI / std::sqrt(mu * alpha * alpha * alpha);
+        dt = std::remainder(dt, period);
+    }
+
+    double chi;
+    if (alpha > 1e-12)
+    {
+        chi = sqrtMu * dt * alpha;
+    }
+    else if (alpha < -1e-12)
+    {
+        double a = 1.0 / alpha;
+        double sgn = dt > 0.0 ? 1.0 : -1.0;
+        double arg = -2.0 * mu * alpha * dt / (rv + sgn * std::sqrt(-mu * a) * (1.0 - r0 * alpha));
+        chi = sgn * std::sqrt(-a) * std::log(std::max(arg, 1e-12));
+    }
+    else
+    {
+        chi = sqrtMu * dt / r0;
+    }
+
+    // Newton on the universal Kepler equation, safeguarded: f is increasing in
+    // chi with f(0) = -sqrt(mu) dt, and on ellipses one period either side
+    // brackets the root. A step leaving the bracket (near-rectilinear orbits)
+    // bisects, or doubles outward while one side is still open.
+    const double inf = std::numeric_limits<double>::infinity();
+    double lo = dt > 0.0 ? 0.0 : -inf, hi = dt > 0.0 ? inf : 0.0;
+    if (alpha > 1e-12)
+    {
+        double bound = 2.0 * KEPLER_PI / std::sqrt(alpha);
+        lo = std::max(lo, -bound);
+        hi = std::min(hi, bound);
+    }
+
+    double c = 0.5, s = 1.0 / 6.0, psi = 0.0, r = r0;
+    for (int it = 0; it < 100; ++it)
+    {
+        psi = chi * chi * alpha;
+        stumpff(psi, c, s);
+        double chi2 = chi * chi;
+        r = chi2 * c + rv / sqrtMu * chi * (1.0 - psi * s) + r0 * (1.0 - psi * c);
+        double f = rv / sqrtMu * chi2 * c + (1.0 - r0 * alpha) * chi2 * chi * s + r0 * chi - sqrtMu * dt;
+        if (f < 0.0) lo = chi;
+        else hi = chi;
+
+        double next = chi - f / r;
+        if (!(next > lo && next < hi))
+        {
+            if (hi == inf) next = 2.0 * std::max(lo, 1.0);
+            else if (lo == -inf) next = 2.0 * std::min(hi, -1.0);
+            else next = 0.5 * (lo + hi);
+        }
+        double step = chi - next;
+        chi = next;
+        if (std::abs(step) < 1e-10 * std::max(1.0, std::abs(chi))) break;
+    }
+
+    psi = chi * chi * alpha;
+    stumpff(psi, c, s);
+    double chi2 = chi * chi;
+    double f = 1.0 - chi2 / r0 * c;
+    double g = dt - chi2 * chi / sqrtMu * s;
+
+    KeplerState out;
+    out.r = s0.r * f + s0.v * g;
+    double rn = norm(out.r);
+    double fdot = sqrtMu / (rn * r0) * (psi * chi * s - chi);
+    double gdot = 1.0 - chi2 / rn * c;
+    out.v = s0.r * fdot + s0.v * gdot;
+    return out;
+}
+
+// Orbital period, or for unbound orbits the time to sweep 2 pi r at the current
+// speed, as a time scale for step and window sizes.
+inline double orbitTimescale(const KeplerState& s, double mu)
+{
+    double r = norm(s.r);
+    double alpha = 2.0 / r - dot(s.v, s.v) / mu;
+    return alpha > 1e-12
+        ? 2.0 * KEPLER_PI / std::sqrt(mu * alpha * alpha * alpha)
+        : 2.0 * KEPLER_PI * r / std::max(norm(s.v), 1e-9);
+}
+
+// Radial extent of the conic through a state; apoapsis is infinite if unbound.
+struct ConicBounds
+{
+    double periapsis = 0.0;
+    double apoapsis = std::numeric_limits<double>::infinity();
+    bool bound = false;
+};
+
+inline ConicBounds conicBounds(const KeplerState& s, double mu)
+{
+    double r = norm(s.r);
+    double v2 = dot(s.v, s.v);
+    double h = cross(s.r, s.v);
+    Vec2d e = (s.r * (v2 - mu / r) - s.v * dot(s.r, s.v)) / mu;
+    double ecc = norm(e);
+    double p = h * h / mu;                          // semi-latus rectum
+
+    ConicBounds b;
+    b.periapsis = p / (1.0 + ecc);
+    b.bound = ecc < 1.0;
+    if (b.bound) b.apoapsis = p / (1.0 - ecc);
+    return b;
+}
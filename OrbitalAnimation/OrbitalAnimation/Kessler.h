@@ -0,0 +1,453 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "Breakup.h"
+#include "Ensemble.h"
+#include "Kepler.h"
+#include "Parallel.h"
+#include "Physics.h"
+#include "SemiAnalytic.h"
+
+// Long-horizon evolution of a debris population (Kessler cascade). Objects
+// are carried as mean elements and advanced in warp steps of many
+// revolutions, with orbit-averaged drag scaled by each object's own
+// area-to-mass ratio, as in the lifetime study. Contacts cannot be seen at
+// that step size, so collisions are sampled the way the cube method does
+// (Liou et al.): at the end of each step objects are binned into square
+// cells, the plane standing for a layer one cell deep, and each pair sharing
+// a cell collides with probability
+//   P = v_rel * sigma * h / cell^3,  sigma = pi (R_a + R_b)^2
+// which is their expected encounter rate if both were spread over the cube.
+// Real orbits cross at an angle; each object keeps the tilt of its orbital
+// plane about the radius, and encounter speeds come from velocities rotated
+// out of the plane by it (about 10 km/s on average, as in low orbit, instead
+// of the near-zero speeds of coplanar circular orbits).
+// A collision breaks both objects up with the SBM (Breakup.h) and the
+// fragments join the population on the osculating orbits they start on.
+// Objects live in fixed blocks that are freed as the population shrinks, so
+// memory follows the live population.
+
+const size_t KESSLER_BLOCK = 65536;        // objects per population block
+const size_t KESSLER_CHUNK = 4096;         // objects a worker takes at a time
+const int KESSLER_ALTITUDE_BINS = 16;
+
+struct DebrisObject
+{
+    MeanElements el;
+    float mass = 0.f;             // kg
+    float radius = 0.f;           // m, sets the collision cross-section
+    float ballistic = 0.f;        // drag coefficient, from the area-to-mass ratio
+    float tilt = 0.f;             // plane angle about the radius, for encounter speeds
+    bool fragment = false;
+    bool live = true;
+};
+
+// Dense from index 0 across the blocks; removal moves the last object into
+// the hole and frees blocks that fall past the end.
+struct DebrisPopulation
+{
+    std::vector<std::unique_ptr<std::vector<DebrisObject>>> blocks;
+    size_t count = 0;
+
+    size_t size() const { return count; }
+
+    DebrisObject& operator[](size_t i) { return (*blocks[i / KESSLER_BLOCK])[i % KESSLER_BLOCK]; }
+
+    void push(const DebrisObject& o)
+    {
+        if (count == blocks.size() * KESSLER_BLOCK)
+        {
+            blocks.push_back(std::make_unique<std::vector<DebrisObject>>());
+            blocks.back()->reserve(KESSLER_BLOCK);
+        }
+        blocks.back()->push_back(o);
+        ++count;
+    }
+
+    // Drop every object that is no longer live. Returns how many went.
+    size_t compact()
+    {
+        const size_t before = count;
+        for (size_t i = 0; i < count;)
+        {
+            if ((*this)[i].live)
+            {
+                ++i;
+                continue;
+            }
+            (*this)[i] = (*this)[count - 1];
+            blocks.back()->pop_back();
+            if (blocks.back()->empty()) blocks.pop_back();
+            --count;
+        }
+        return before - count;
+    }
+};
+
+struct KesslerSpec
+{
+    uint64_t objects = 10000;
+    uint64_t seed = 1;
+    double year = 1e6;            // sim seconds per year
+    double years = 50.0;          // horizon
+    double step = 0.0;            // warp step, sim seconds
+    double report = 0.0;          // sim seconds between statistics rows
+    double minRadius = 0.0, maxRadius = 0.0;
+    double maxEccentricity = 0.0;
+    double surfaceRadius = 0.0;
+    double escapeRadius = 1e9;
+    double binTop = 0.0;          // altitude bins span [0, binTop), mean altitude a - surface
+    double cell = 2.0;            // collision sampling cube edge
+    double metersPerUnit = 1.0;   // for the cross-sections and the SBM
+    float mass = 0.f;             // intact objects
+    float radius = 0.f;
+    float areaToMass = 0.f;       // m^2 / kg
+    float ballisticScale = 0.f;   // drag coefficient per m^2 / kg
+};
+
+struct KesslerSample
+{
+    double years = 0.0;
+    size_t objects = 0, intact = 0, fragments = 0;
+    uint64_t collisions = 0;      // since the previous sample
+    uint64_t reentered = 0, escaped = 0;
+    std::array<uint64_t, KESSLER_ALTITUDE_BINS> altitude{};
+};
+
+struct KesslerStats
+{
+    uint64_t steps = 0;
+    uint64_t collisions = 0, fragments = 0;
+    uint64_t reentered = 0, escaped = 0;
+    size_t peak = 0;
+    KesslerSample last;
+    double milliseconds = 0.0;
+};
+
+enum class DebrisOutcome { Bound, Reentered, Escaped };
+
+// One warp step of h for one object. Orbits that stay above the atmosphere
+// with no tangential drift keep their elements and only move along; an orbit
+// that changes too fast to average is in its final plunge.
+inline DebrisOutcome advanceDebris(DebrisObject& o, double h, const KesslerSpec& spec, const ForceModel& force)
+{
+    const double mu = force.mu;
+    const bool drag = hasDrag(force) && o.ballistic > 0.f
+        && o.el.periapsis() < spec.surfaceRadius + force.atmosphere->ceiling;
+    if (!drag && force.j2 == 0.f)
+    {
+        o.el.lambda += std::sqrt(mu / (o.el.a * o.el.a * o.el.a)) * h;
+        return DebrisOutcome::Bound;
+    }
+
+    ForceModel f = force;
+    f.ballistic = o.ballistic;
+    auto perturb = [&f, mu](Vec2d x, Vec2d v)
+    {
+        double r = norm(x);
+        return accelerationAt(f, x, v) + x * (mu / (r * r * r));
+    };
+
+    for (double t = 0.0; t < h;)
+    {
+        ElementRates rates = averagedRates(o.el, mu, perturb);
+        double step = meanElementStep(o.el, rates);
+        double taken = step > 0.0 ? advanceMeanElements(o.el, std::min(step, h - t), mu, perturb, rates) : 0.0;
+        if (taken == 0.0 || o.el.periapsis() <= spec.surfaceRadius) return DebrisOutcome::Reentered;
+        if (o.el.a * (1.0 + o.el.eccentricity()) > spec.escapeRadius) return DebrisOutcome::Escaped;
+        t += taken;
+    }
+    return DebrisOutcome::Bound;
+}
+
+inline DebrisObject kesslerObject(const KesslerSpec& spec, uint64_t k)
+{
+    auto bits = philox4x32({ uint32_t(k), uint32_t(k >> 32), 4u, 0u }, { uint32_t(spec.seed), uint32_t(spec.seed >> 32) });
+
+    DebrisObject o;
+    double e = spec.maxEccentricity * uniform01(bits[1]);
+    double omega = 2.0 * KEPLER_PI * uniform01(bits[2]);
+    o.el.a = (spec.minRadius + (spec.maxRadius - spec.minRadius) * uniform01(bits[0])) / (1.0 - e);
+    o.el.ex = e * std::cos(omega);
+    o.el.ey = e * std::sin(omega);
+    o.el.lambda = 2.0 * KEPLER_PI * uniform01(bits[3]);
+    auto tilt = philox4x32({ uint32_t(k), uint32_t(k >> 32), 4u, 1u }, { uint32_t(spec.seed), uint32_t(spec.seed >> 32) });
+    o.tilt = static_cast<float>(KEPLER_PI * uniform01(tilt[0]));
+    o.mass = spec.mass;
+    o.radius = spec.radius;
+    o.ballistic = spec.ballisticScale * spec.areaToMass;
+    return o;
+}
+
+// Per-object inputs of the collision pass, filled in as objects are advanced.
+struct KesslerScratch
+{
+    std::vector<KeplerState> state;
+    std::vector<sf::Vector3f> velocity;   // encounter velocity, see encounterVelocity
+    std::vector<int32_t> cx, cy;
+    std::vector<uint32_t> start, order, bucket;
+
+    void resize(size_t n)
+    {
+        // drop capacity left over from a much larger population
+        if (state.capacity() > 2 * n + KESSLER_BLOCK) *this = KesslerScratch();
+        state.resize(n); velocity.resize(n);
+        cx.resize(n); cy.resize(n);
+        bucket.resize(n); order.resize(n);
+    }
+};
+
+// Velocity at an encounter: the horizontal part turned out of the plane by
+// the object's tilt. Objects sharing a cell are close enough for each to use
+// its own radial direction.
+inline sf::Vector3f encounterVelocity(const KeplerState& s, float tilt)
+{
+    const Vec2d up = s.r / norm(s.r), side(-up.y, up.x);
+    const double radial = dot(s.v, up), horizontal = dot(s.v, side);
+    const Vec2d inPlane = up * radial + side * (horizontal * std::cos(tilt));
+    return { static_cast<float>(inPlane.x), static_cast<float>(inPlane.y), static_cast<float>(horizontal * std::sin(tilt)) };
+}
+
+inline void prepareCollisions(KesslerScratch& scratch, size_t i, const DebrisObject& o, double mu, double cell)
+{
+    const KeplerState s = stateOf(o.el, mu);
+    scratch.state[i] = s;
+    scratch.velocity[i] = encounterVelocity(s, o.tilt);
+    scratch.cx[i] = static_cast<int32_t>(std::floor(s.r.x / cell));
+    scratch.cy[i] = static_cast<int32_t>(std::floor(s.r.y / cell));
+}
+
+struct KesslerCollision
+{
+    uint32_t a, b;
+    double relativeSpeed;         // sim units
+};
+
+// Samples this step's collisions among the live objects, whose scratch
+// entries are prepared: every pair sharing a cell collides with the
+// cube-method probability. Rather than one draw per pair, the pairs' hazards
+// -log(1 - P) are summed until they pass an exponential draw, which picks
+// pairs with the same odds at one draw per collision. Cells are bucketed by
+// the low bits of their coordinates through one counting sort, as in
+// CollisionGrid.
+inline void sampleCollisions(DebrisPopulation& pop, const KesslerSpec& spec, double h, uint64_t stepIndex,
+    KesslerScratch& scratch, std::vector<KesslerCollision>& out)
+{
+    out.clear();
+    const size_t n = pop.size();
+    if (n < 2) return;
+
+    int bits = 1;
+    while ((size_t(1) << bits) < n) ++bits;
+    const int xBits = (bits + 1) / 2;
+    const uint32_t xMask = (1u << xBits) - 1, yMask = (1u << (bits - xBits)) - 1;
+    const size_t buckets = size_t(1) << bits;
+    scratch.start.assign(buckets + 1, 0);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (!pop[i].live) continue;
+        scratch.bucket[i] = (uint32_t(scratch.cx[i]) & xMask) | ((uint32_t(scratch.cy[i]) & yMask) << xBits);
+        ++scratch.start[scratch.bucket[i] + 1];
+    }
+    for (size_t b = 0; b < buckets; ++b) scratch.start[b + 1] += scratch.start[b];
+    for (size_t i = 0; i < n; ++i)
+        if (pop[i].live) scratch.order[scratch.start[scratch.bucket[i]]++] = static_cast<uint32_t>(i);
+    for (size_t b = buckets; b > 0; --b) scratch.start[b] = scratch.start[b - 1];
+    scratch.start[0] = 0;
+
+    uint32_t draws = 0;
+    auto threshold = [&]
+    {
+        auto draw = philox4x32({ draws++, uint32_t(stepIndex), 5u, uint32_t(stepIndex >> 32) }, { uint32_t(spec.seed), uint32_t(spec.seed >> 32) });
+        return -std::log(uniform01(draw[0]));
+    };
+
+    const double scale = KEPLER_PI * h / (spec.cell * spec.cell * spec.cell * spec.metersPerUnit * spec.metersPerUnit);
+    double hazard = 0.0, next = threshold();
+    for (size_t b = 0; b < buckets; ++b)
+    {
+        for (uint32_t p = scratch.start[b]; p < scratch.start[b + 1]; ++p)
+        {
+            const uint32_t i = scratch.order[p];
+            for (uint32_t q = p + 1; q < scratch.start[b + 1] && pop[i].live; ++q)
+            {
+                const uint32_t j = scratch.order[q];
+                if (!pop[j].live || scratch.cx[i] != scratch.cx[j] || scratch.cy[i] != scratch.cy[j]) continue;
+
+                sf::Vector3f dv = scratch.velocity[i] - scratch.velocity[j];
+                double speed = std::sqrt(double(dv.x) * dv.x + double(dv.y) * dv.y + double(dv.z) * dv.z);
+                double reach = static_cast<double>(pop[i].radius) + pop[j].radius;
+                hazard -= std::log1p(-std::min(speed * reach * reach * scale, 1.0 - 1e-12));
+                if (hazard < next) continue;
+
+                out.push_back({ i, j, speed });
+                pop[i].live = pop[j].live = false;   // retired; each object collides at most once per step
+                hazard = 0.0;
+                next = threshold();
+            }
+        }
+    }
+}
+
+// Row of the statistics table: time, counts, collision rate and the
+// population per mean-altitude bin.
+inline void writeKesslerHeader(std::FILE* f, const KesslerSpec& spec)
+{
+    std::fprintf(f, "years,objects,intact,fragments,collisions,collisions_per_year,reentered,escaped");
+    for (int b = 0; b < KESSLER_ALTITUDE_BINS; ++b) std::fprintf(f, ",alt_%g", spec.binTop * b / KESSLER_ALTITUDE_BINS);
+    std::fprintf(f, "\n");
+}
+
+inline void writeKesslerRow(std::FILE* f, const KesslerSample& s, double interval)
+{
+    std::fprintf(f, "%.4f,%zu,%zu,%zu,%llu,%.4g,%llu,%llu", s.years, s.objects, s.intact, s.fragments,
+        static_cast<unsigned long long>(s.collisions), interval > 0.0 ? s.collisions / interval : 0.0,
+        static_cast<unsigned long long>(s.reentered), static_cast<unsigned long long>(s.escaped));
+    for (uint64_t c : s.altitude) std::fprintf(f, ",%llu", static_cast<unsigned long long>(c));
+    std::fprintf(f, "\n");
+    std::fflush(f);
+}
+
+// Runs the horizon, streaming a statistics row to out every spec.report.
+// force.center is ignored: objects are followed relative to the central body.
+inline KesslerStats runKessler(const KesslerSpec& spec, ForceModel force, unsigned threads, std::FILE* out)
+{
+    auto start = std::chrono::steady_clock::now();
+    force.center = { 0.f, 0.f };
+    const double mu = force.mu;
+
+    DebrisPopulation pop;
+    for (uint64_t k = 0; k < spec.objects; ++k) pop.push(kesslerObject(spec, k));
+
+    KesslerStats stats;
+    stats.peak = pop.size();
+    KesslerSample sample;
+    KesslerScratch scratch;
+    std::vector<KesslerCollision> collisions;
+    std::atomic<uint64_t> reentered{ 0 }, escaped{ 0 };
+    double reported = 0.0;
+
+    auto report = [&](double t)
+    {
+        sample.years = t / spec.year;
+        sample.objects = pop.size();
+        sample.intact = sample.fragments = 0;
+        sample.altitude.fill(0);
+        for (size_t i = 0; i < pop.size(); ++i)
+        {
+            const DebrisObject& o = pop[i];
+            ++(o.fragment ? sample.fragments : sample.intact);
+            int bin = static_cast<int>((o.el.a - spec.surfaceRadius) / spec.binTop * KESSLER_ALTITUDE_BINS);
+            ++sample.altitude[std::clamp(bin, 0, KESSLER_ALTITUDE_BINS - 1)];
+        }
+        sample.reentered = reentered;
+        sample.escaped = escaped;
+        if (out) writeKesslerRow(out, sample, (t - reported) / spec.year);   // the last period may be short
+        reported = t;
+        stats.last = sample;
+        sample.collisions = 0;
+    };
+
+    if (out) writeKesslerHeader(out, spec);
+    report(0.0);
+
+    const double horizon = spec.years * spec.year;
+    double nextReport = spec.report;
+    for (double t = 0.0; t < horizon && pop.size() > 0;)
+    {
+        const double h = std::min(spec.step, horizon - t);
+
+        // every object is independent within a step; survivors also get
+        // their collision inputs here, so the Kepler solves run in parallel
+        scratch.resize(pop.size());
+        parallelFor(pop.size(), KESSLER_CHUNK, threads, "kessler", [&](size_t first, size_t last, unsigned)
+        {
+            for (size_t i = first; i < last; ++i)
+            {
+                DebrisOutcome outcome = advanceDebris(pop[i], h, spec, force);
+                if (outcome == DebrisOutcome::Bound)
+                {
+                    prepareCollisions(scratch, i, pop[i], mu, spec.cell);
+                    continue;
+                }
+                pop[i].live = false;
+                ++(outcome == DebrisOutcome::Reentered ? reentered : escaped);
+            }
+        });
+        t += h;
+
+        sampleCollisions(pop, spec, h, stats.steps, scratch, collisions);
+        for (const KesslerCollision& c : collisions)
+        {
+            const DebrisObject a = pop[c.a], b = pop[c.b];
+            const KeplerState& sa = scratch.state[c.a];
+            const KeplerState& sb = scratch.state[c.b];
+            const double total = static_cast<double>(a.mass) + b.mass;
+            const KeplerState center = { (sa.r * double(a.mass) + sb.r * double(b.mass)) / total,
+                                         (sa.v * double(a.mass) + sb.v * double(b.mass)) / total };
+            const DebrisObject& heavier = a.mass >= b.mass ? a : b;
+            const double fragmenting = breakupMass(a.mass, b.mass, c.relativeSpeed / BREAKUP_SPEED_SCALE);
+            const uint32_t event = static_cast<uint32_t>(stats.collisions++);
+
+            size_t count = breakupCount(fragmenting, spec.seed, event);
+            stats.fragments += breakupFragments(center, total, count, spec.seed, event,
+                [&](const KeplerState& s, double mass, double length, double areaToMass)
+                {
+                    DebrisObject o;
+                    if (!elementsOf(s, mu, o.el))
+                    {
+                        ++escaped;
+                        return;
+                    }
+                    if (o.el.periapsis() <= spec.surfaceRadius)
+                    {
+                        ++reentered;
+                        return;
+                    }
+                    o.mass = static_cast<float>(mass);
+                    o.radius = length > 0.0 ? static_cast<float>(0.5 * length) : heavier.radius;
+                    o.ballistic = areaToMass > 0.0 ? spec.ballisticScale * static_cast<float>(areaToMass) : heavier.ballistic;
+                    o.tilt = heavier.tilt;
+                    o.fragment = true;
+                    pop.push(o);
+                });
+            ++sample.collisions;
+        }
+        stats.peak = std::max(stats.peak, pop.size());
+        pop.compact();
+        ++stats.steps;
+
+        if (t >= nextReport || t >= horizon)
+        {
+            report(t);
+            nextReport += spec.report;
+        }
+    }
+
+    stats.reentered = reentered;
+    stats.escaped = escaped;
+    stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+inline void printKessler(const KesslerSpec& spec, const KesslerStats& s)
+{
+    std::printf("kessler %llu objects over %.3g years, seed %llu: %.0f ms (%llu warp steps of %.3g years)\n",
+        static_cast<unsigned long long>(spec.objects), spec.years, static_cast<unsigned long long>(spec.seed), s.milliseconds,
+        static_cast<unsigned long long>(s.steps), spec.step / spec.year);
+    std::printf("  collisions %llu, fragments %llu, re-entered %llu, escaped %llu\n",
+        static_cast<unsigned long long>(s.collisions), static_cast<unsigned long long>(s.fragments),
+        static_cast<unsigned long long>(s.reentered), static_cast<unsigned long long>(s.escaped));
+    std::printf("  final population %zu (%zu intact, %zu fragments), peak %zu\n",
+        s.last.objects, s.last.intact, s.last.fragments, s.peak);
+}
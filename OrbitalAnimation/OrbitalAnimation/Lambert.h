@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+
+#include "Simd.h"
+
+// Lambert's problem (zero revolutions, prograde = counter-clockwise) after
+// Izzo, "Revisiting Lambert's problem" (2015), four problems per call in SSE
+// lanes. Every lane runs the same fixed number of Householder iterations on
+// the non-dimensional tof equation T(x) = T, so there is no per-lane branching;
+// branches of the original become selects.
+//
+// Single precision is plenty for transfer planning: on random geometries the
+// arrival miss after Kepler propagation of the solution is ~1e-6 of |r2|
+// typically and 1e-3 at worst, for transfers that clear the central body.
+
+const int LAMBERT_ITERATIONS = 8;
+const float LAMBERT_BATTIN = 0.01f;        // |x - 1| below which T(x) uses Battin's series
+
+// Non-dimensional time of flight T(x) for the given lambda.
+inline f32x4 lambertTof(f32x4 x, f32x4 lambda)
+{
+    const f32x4 one(1.f);
+    f32x4 lambda2 = lambda * lambda;
+    f32x4 e = x * x - one;
+    f32x4 z = sqrt(max(one + lambda2 * e, f32x4(0.f)));
+
+    // general form: acos on ellipses, log on hyperbolas
+    f32x4 y = sqrt(abs(e));
+    f32x4 g = x * z - lambda * e;
+    f32x4 dEllipse = acos(min(max(g, -one), one));
+    f32x4 dHyperbola = log(max(y * (z - lambda * x) + g, f32x4(1e-30f)));
+    f32x4 d = select(e < f32x4(0.f), dEllipse, dHyperbola);
+    f32x4 general = (x - lambda * z - d / y) / e;
+
+    // near parabolic: hypergeometric 2F1(3, 1; 5/2; s1)
+    f32x4 eta = z - lambda * x;
+    f32x4 s1 = f32x4(0.5f) * (one - lambda - x * eta);
+    f32x4 term = one, sum = one;
+    for (int j = 0; j < 10; ++j)
+    {
+        float jf = static_cast<float>(j);
+        term = term * f32x4((3.f + jf) * (1.f + jf) / ((2.5f + jf) * (jf + 1.f))) * s1;
+        sum += term;
+    }
+    f32x4 q = f32x4(4.f / 3.f) * sum;
+    f32x4 series = f32x4(0.5f) * (eta * eta * eta * q + f32x4(4.f) * lambda * eta);
+
+    return select(abs(x - one) < f32x4(LAMBERT_BATTIN), series, general);
+}
+
+// Velocities at both ends of the transfer from r1 to r2 taking tof. Positions
+// are relative to the central body. Lanes without a solution come out NaN.
+inline void lambert4(f32x4 r1x, f32x4 r1y, f32x4 r2x, f32x4 r2y, f32x4 tof, float mu,
+    f32x4& v1x, f32x4& v1y, f32x4& v2x, f32x4& v2y)
+{
+    const f32x4 one(1.f), zero(0.f);
+    f32x4 r1 = sqrt(r1x * r1x + r1y * r1y);
+    f32x4 r2 = sqrt(r2x * r2x + r2y * r2y);
+    f32x4 cx = r2x - r1x, cy = r2y - r1y;
+    f32x4 c = sqrt(cx * cx + cy * cy);
+    f32x4 s = f32x4(0.5f) * (r1 + r2 + c);
+
+    // lambda < 0 when the counter-clockwise transfer angle exceeds pi
+    f32x4 lambda2 = max(one - c / s, zero);
+    f32x4 lambda = sqrt(lambda2);
+    lambda = select(r1x * r2y - r1y * r2x < zero, -lambda, lambda);
+    f32x4 lambda3 = lambda2 * lambda;
+    f32x4 t = sqrt(f32x4(2.f * mu) / (s * s * s)) * tof;
+
+    // Izzo's initial guess from the minimum-energy and parabolic flight times
+    f32x4 t00 = acos(lambda) + lambda * sqrt(one - lambda2);
+    f32x4 t1 = f32x4(2.f / 3.f) * (one - lambda3);
+    f32x4 xLong = -(t - t00) / (t - t00 + f32x4(4.f));
+    f32x4 xShort = t1 * (t1 - t) / (f32x4(0.4f) * (one - lambda2 * lambda3) * t) + one;
+    f32x4 exponent = f32x4(0.69314718f) / log(max(t1 / t00, f32x4(1e-30f)));
+    f32x4 xMid = exp(exponent * log(max(t / t00, f32x4(1e-30f)))) - one;
+    f32x4 x = select(t >= t00, xLong, select(t <= t1, xShort, xMid));
+
+    // Householder (third order) on T(x) - t
+    for (int it = 0; it < LAMBERT_ITERATIONS; ++it)
+    {
+        f32x4 tx = lambertTof(x, lambda);
+        f32x4 umx2 = one - x * x;
+        umx2 = select(abs(umx2) < f32x4(1e-6f), select(umx2 < zero, f32x4(-1e-6f), f32x4(1e-6f)), umx2);
+        f32x4 y = sqrt(max(one - lambda2 * umx2, f32x4(1e-30f)));
+        f32x4 y3 = y * y * y;
+        f32x4 dt = (f32x4(3.f) * tx * x - f32x4(2.f) + f32x4(2.f) * lambda3 * x / y) / umx2;
+        f32x4 ddt = (f32x4(3.f) * tx + f32x4(5.f) * x * dt + f32x4(2.f) * (one - lambda2) * lambda3 / y3) / umx2;
+        f32x4 dddt = (f32x4(7.f) * x * ddt + f32x4(8.f) * dt
+            - f32x4(6.f) * (one - lambda2) * lambda2 * lambda3 * x / (y3 * y * y)) / umx2;
+
+        f32x4 f = tx - t;
+        f32x4 dt2 = dt * dt;
+        f32x4 step = f * (dt2 - f * ddt * f32x4(0.5f)) / (dt * (dt2 - f * ddt) + dddt * f * f * f32x4(1.f / 6.f));
+        x = max(x - step, f32x4(-0.999999f));   // stay on the physical branch
+    }
+
+    // reconstruct the terminal velocities
+    f32x4 gamma = sqrt(f32x4(0.5f * mu) * s);
+    f32x4 rho = (r1 - r2) / c;
+    f32x4 sigma = sqrt(max(one - rho * rho, zero));
+    f32x4 y = sqrt(one - lambda2 + lambda2 * x * x);
+    f32x4 a = lambda * y - x, b = lambda * y + x;
+    f32x4 vr1 = gamma * (a - rho * b) / r1;
+    f32x4 vr2 = -gamma * (a + rho * b) / r2;
+    f32x4 vt = gamma * sigma * (y + lambda * x);
+    f32x4 vt1 = vt / r1, vt2 = vt / r2;
+
+    // radial and counter-clockwise tangential unit vectors
+    f32x4 i1x = r1x / r1, i1y = r1y / r1, i2x = r2x / r2, i2y = r2y / r2;
+    v1x = vr1 * i1x - vt1 * i1y;
+    v1y = vr1 * i1y + vt1 * i1x;
+    v2x = vr2 * i2x - vt2 * i2y;
+    v2y = vr2 * i2y + vt2 * i2x;
+}
+
+// Structure-of-arrays batch of Lambert problems solved four at a time. For
+// clockwise transfers pass mirrored (y -> -y) positions and mirror the result.
+struct LambertBatch
+{
+    std::vector<float> r1x, r1y, r2x, r2y, tof;   // inputs
+    std::vector<float> v1x, v1y, v2x, v2y;        // outputs
+
+    void clear()
+    {
+        for (std::vector<float>* a : { &r1x, &r1y, &r2x, &r2y, &tof }) a->clear();
+    }
+
+    void push(float ax, float ay, float bx, float by, float t)
+    {
+        r1x.push_back(ax); r1y.push_back(ay);
+        r2x.push_back(bx); r2y.push_back(by);
+        tof.push_back(t);
+    }
+
+    size_t size() const { return r1x.size(); }
+
+    void solve(float mu)
+    {
+        const size_t n = size();
+        size_t padded = (n + 3) & ~size_t(3);
+        for (std::vector<float>* a : { &r1x, &r1y, &r2x, &r2y, &tof }) a->resize(padded, n ? a->back() : 1.f);
+        for (std::vector<float>* a : { &v1x, &v1y, &v2x, &v2y }) a->resize(padded);
+
+        for (size_t i = 0; i < padded; i += 4)
+        {
+            f32x4 ax, ay, bx, by;
+            lambert4(f32x4::load(&r1x[i]), f32x4::load(&r1y[i]), f32x4::load(&r2x[i]), f32x4::load(&r2y[i]),
+                f32x4::load(&tof[i]), mu, ax, ay, bx, by);
+            ax.store(&v1x[i]); ay.store(&v1y[i]);
+            bx.store(&v2x[i]); by.store(&v2y[i]);
+        }
+
+        for (std::vector<float>* a : { &r1x, &r1y, &r2x, &r2y, &tof, &v1x, &v1y, &v2x, &v2y }) a->resize(n);
+    }
+};
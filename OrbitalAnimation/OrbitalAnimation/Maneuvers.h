@@ -0,0 +1,146 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <queue>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Kepler.h"
+
+// Mission timeline: burns at exact sim times, kept in a min-heap on time so the
+// step loop only ever compares against the earliest one.
+//
+// Burn directions are in the body's local frame at the moment of the burn:
+// prograde along the velocity, radial away from the central body. A finite
+// burn is applied as midpoint impulses over slices of MANEUVER_BURN_SLICE; each
+// slice re-queues the rest of the burn, so the heap holds one entry per burn.
+
+const double MANEUVER_BURN_SLICE = 1.0 / 32.0;
+
+enum class BurnKind
+{
+    Impulse,        // prograde/radial are a velocity change
+    Finite          // prograde/radial are an acceleration held for duration
+};
+
+struct Maneuver
+{
+    double t = 0.0;               // impulse time, or midpoint of the current slice
+    uint32_t body = 0;
+    BurnKind kind = BurnKind::Impulse;
+    double prograde = 0.0;
+    double radial = 0.0;
+    double duration = 0.0;        // finite burns: burn time left, this slice included
+};
+
+// Velocity change of an impulse in the local frame of state s.
+inline Vec2d burnDeltaV(const KeplerState& s, double prograde, double radial)
+{
+    double speed = norm(s.v), dist = norm(s.r);
+    Vec2d along = speed > 0.0 ? s.v / speed : Vec2d();
+    Vec2d out = dist > 0.0 ? s.r / dist : Vec2d();
+    return along * prograde + out * radial;
+}
+
+struct ManeuverTimeline
+{
+    struct Later
+    {
+        bool operator()(const Maneuver& a, const Maneuver& b) const { return a.t > b.t; }
+    };
+
+    std::priority_queue<Maneuver, std::vector<Maneuver>, Later> queue;
+
+    // t is the start of the burn; finite burns are queued at their first slice midpoint.
+    void schedule(Maneuver m)
+    {
+        if (m.kind == BurnKind::Finite)
+        {
+            if (m.duration <= 0.0) return;
+            m.t += 0.5 * std::min(MANEUVER_BURN_SLICE, m.duration);
+        }
+        queue.push(m);
+    }
+
+    bool due(double t) const { return !queue.empty() && queue.top().t <= t; }
+    size_t size() const { return queue.size(); }
+
+    Maneuver pop()
+    {
+        Maneuver m = queue.top();
+        queue.pop();
+        return m;
+    }
+
+    // Velocity change of a popped burn for state s at its time; the rest of a
+    // finite burn goes back on the queue.
+    Vec2d fire(const Maneuver& m, const KeplerState& s)
+    {
+        if (m.kind == BurnKind::Impulse) return burnDeltaV(s, m.prograde, m.radial);
+
+        double slice = std::min(MANEUVER_BURN_SLICE, m.duration);
+        double left = m.duration - slice;
+        if (left > 1e-9)
+        {
+            Maneuver rest = m;
+            rest.duration = left;
+            rest.t = m.t + 0.5 * slice + 0.5 * std::min(MANEUVER_BURN_SLICE, left);
+            queue.push(rest);
+        }
+        return burnDeltaV(s, m.prograde * slice, m.radial * slice);
+    }
+};
+
+// Script lines, '#' starts a comment:
+//     <t> <body> impulse <prograde> <radial>
+//     <t> <body> burn <duration> <prograde> <radial>
+// with a positive duration. Returns the number of burns queued, or -1 if the file cannot be read.
+inline int loadManeuvers(const std::string& path, ManeuverTimeline& timeline)
+{
+    std::ifstream in(path);
+    if (!in) return -1;
+
+    int count = 0, lineNumber = 0;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        ++lineNumber;
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+
+        if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+
+        Maneuver m;
+        std::string kind;
+        bool ok = static_cast<bool>(fields >> m.t >> m.body >> kind);
+        if (ok && kind == "impulse")
+        {
+            m.kind = BurnKind::Impulse;
+            ok = static_cast<bool>(fields >> m.prograde >> m.radial);
+        }
+        else if (ok && kind == "burn")
+        {
+            m.kind = BurnKind::Finite;
+            ok = static_cast<bool>(fields >> m.duration >> m.prograde >> m.radial);
+            ok = ok && m.duration > 0.0;
+        }
+        else
+        {
+            ok = false;
+        }
+
+        if (!ok)
+        {
+            std::printf("maneuvers: %s:%d: cannot parse '%s'\n", path.c_str(), lineNumber, line.c_str());
+            continue;
+        }
+        timeline.schedule(m);
+        ++count;
+    }
+    return count;
+}
@@ -1,9 +1,41 @@
 #include <SFML/Graphics.hpp>
+#include <array>
+#include <chrono>
+#include <deque>
 #include <vector>
 #include <cmath>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
 #include <algorithm>
 #include <limits>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "Breakup.h"
+#include "Config.h"
+#include "Covariance.h"
+#include "Encke.h"
+#include "Ensemble.h"
+#include "Ephemeris.h"
+#include "Events.h"
+#include "Governor.h"
+#include "Kepler.h"
+#include "Kessler.h"
+#include "Maneuvers.h"
+#include "Physics.h"
+#include "Porkchop.h"
+#include "Profiler.h"
+#include "Regularize.h"
+#include "SemiAnalytic.h"
+#include "Swarm.h"
+#include "Sweep.h"
+#include "Telemetry.h"
+#include "ThirdBody.h"
+#include "TimeWarp.h"
+#include "Trace.h"
+#include "Zonal.h"
 
 const sf::Vector2f EARTH_CENTER = { 600.f, 450.f };
 const float G = 0.2f;
@@ -13,18 +45,181 @@ const float EARTH_RADIUS = 90.f;          // match drawn earth radius
 const float MIN_DIST = 1e-3f;             // avoid divide by zero
 const size_t MAX_TRAIL = 3000;
 const float MAX_DT = 0.05f;               // clamp timestep for stability
+const int BODY_CHECK_INTERVAL = 30;       // frames between per-body bookkeeping checks (staggered)
+
+// Drag below Atmosphere.h's ceiling; every satellite shares one ballistic coefficient
+const float DRAG_BALLISTIC = 0.25f;       // Cd * A / m, 0 turns drag off
+const float REENTRY_REPORT_SHIFT = 1.f;   // a re-entry forecast is reprinted when it moves by this much
+
+// Third bodies on circular orbits about Earth, off until M is pressed
+const float MOON_MASS = 250.f;
+const float MOON_DISTANCE = 2500.f;
+const float MOON_RADIUS = 25.f;           // drawn size only
+const float SUN_MASS = 8.8e6f;            // tide about half the Moon's, as on Earth
+const float SUN_DISTANCE = 1e5f;
+const int THIRD_BODY_SAMPLES = 256;       // ephemeris table entries per revolution
+
+// Event detection: apsides, low-altitude crossings and impacts at exact times
+const float LOW_ALTITUDE = 40.f;          // crossing this altitude is reported as a threshold event
+const size_t EVENT_LOG_SIZE = 64;         // recent events kept for the on-screen markers
+const float EVENT_MARKER_SECONDS = 8.f;   // markers fade out over this much sim time
+
+const float MANEUVER_NUDGE = 0.25f;       // Up/Down: prograde/retrograde impulse on the first satellite
+
+// Porkchop window: departures over the longer of the two orbit time scales,
+// flights from PORKCHOP_MIN_TOF to one time scale of the mean-radius orbit
+const float PORKCHOP_MIN_TOF = 0.05f;
+
+// Inclined shell in 3-D under Earth's zonal harmonics, drawn as a projection (I key)
+const int ZONAL_DEGREE = 8;               // J2 .. J8
+const int ZONAL_SHELL_SIZE = 20000;
+const float ZONAL_SHELL_ALTITUDE = 60.f;  // lowest shell
+const float ZONAL_SHELL_SPREAD = 40.f;    // altitudes are spread over this much above it
+const float ZONAL_SHELL_INCLINATION = 53.f; // degrees
+const float ZONAL_DURATION = 3000.f;        // default headless run: about 8 revolutions of the lowest shell
+
+// Bulk populations (keys 1-3, --swarm): pooled blocks on the satellites' kernel, drawn as points.
+// They follow circular or Keplerian speeds, not ORBIT_SPEED_SCALE.
+const size_t SWARM_SPAWN_COUNT = 250000;  // bodies per keypress for shells and debris clouds
+const int WALKER_TOTAL = 1200;
+const int WALKER_PLANES = 24;             // rings, each WALKER_SPACING above the last
+const int WALKER_PHASING = 1;
+const float WALKER_ALTITUDE = 100.f;      // lowest ring
+const float WALKER_SPACING = 6.f;
+const float SHELL_MIN_ALTITUDE = 80.f;    // periapses at or above the atmosphere ceiling
+const float SHELL_MAX_ALTITUDE = 400.f;
+const float SHELL_MAX_ECCENTRICITY = 0.1f;
+const float DEBRIS_SIGMA_POSITION = 2.f;  // per-axis spread around the first satellite
+const float DEBRIS_SIGMA_VELOCITY = 0.1f;
+const float WALKER_MASS = 260.f;          // kg, for the breakup model
+const float SHELL_MASS = 100.f;
+const float DEBRIS_MASS = 1.f;
+
+// Collisions (C key): swarm bodies and satellites closer than COLLISION_DISTANCE
+// break up into fragments that join the swarm
+const float COLLISION_DISTANCE = 0.1f;    // contact distance; far above real sizes, so encounters happen at this scale
+const float SATELLITE_MASS = 500.f;       // kg
+const float FRAGMENT_ARM_TIME = 2.f;      // sim seconds before fresh fragments can collide, so a cloud does not re-collide at birth
+const size_t FRAGMENT_RESERVE = 8 * SWARM_BLOCK; // swarm slots kept reserved for the next breakups
 
 // Lowering this value makes satellites orbit slower (increases orbital period).
 // Set to 1.0 for original speed, <1.0 to slow, >1.0 to speed up.
 // Increased from 0.5 to 3.0 to make orbital period ~6x shorter (orbits run 6x faster).
+// It scales the launch speed, so it changes the orbit itself; the time warp
+// ([ and ], --warp) speeds up sim time without touching the orbits.
 const float ORBIT_SPEED_SCALE = 4.0f;
 
+// Lazy propagation: bodies whose whole orbit lies off-screen are frozen and
+// caught up analytically (two-body only, the small J2 drift is skipped while frozen).
+const float LAZY_SCREEN_MARGIN = 40.f;    // periapsis clearance above Earth before a body may freeze
+const float LAZY_VIEW_MARGIN = 50.f;      // wake a little before the orbit reaches the view
+const int LAZY_TRAIL_SAMPLES = 64;        // trail points filled in along the skipped arc
+
+// Regularized propagation (Levi-Civita + Sundman) for eccentric orbits
+const float REG_MIN_ECCENTRICITY = 0.5f;  // bodies above this leave the block grid when enabled
+const int REG_MAX_STEPS_PER_FRAME = 512;  // guards against a runaway near-collision orbit
+
+// Encke propagation around an analytic reference conic for weakly perturbed bodies
+const float ENCKE_MAX_PERTURBATION = 0.02f; // |J2 drift| / |gravity| below which a body qualifies
+const int ENCKE_MAX_STEPS_PER_FRAME = 64;
+
+// Uncertainty: per-satellite state covariance carried by sigma points, with
+// ellipses drawn along the ghost path of the first satellite
+const float UNCERTAINTY_POSITION = 2.f;    // initial 1-sigma position error per axis
+const float UNCERTAINTY_VELOCITY = 0.05f;  // initial 1-sigma velocity error per axis
+const float UNCERTAINTY_SIGMAS = 3.f;      // ellipses are drawn at this many sigma
+const float UNCERTAINTY_HORIZON = 8.f;     // sim seconds ahead, the span of the ghost path
+const float UNCERTAINTY_SPACING = 0.5f;    // sim seconds between ellipses
+const int UNCERTAINTY_SEGMENTS = 32;       // line segments per ellipse
+
+// Headless Monte Carlo ensemble (--ensemble <members>) dispersed around the starter orbit
+const float ENSEMBLE_SIGMA_POSITION = 2.f;    // default per-axis position spread
+const float ENSEMBLE_SIGMA_VELOCITY = 0.05f;  // default per-axis velocity spread
+
+// Headless runs (--ensemble, --sweep)
+const float HEADLESS_DURATION = 60.f;         // default sim seconds followed per run
+const float HEADLESS_ESCAPE_RADIUS = 2000.f;  // bodies beyond this count as escaped
+
+// Lifetime studies (--lifetime <objects>): orbit-averaged propagation of a random population
+const float LIFETIME_YEARS = 25.f;            // default horizon, in the years --kessler uses
+const float LIFETIME_MIN_ALTITUDE = 20.f;     // periapsis altitudes are drawn between these
+const float LIFETIME_MAX_ALTITUDE = 150.f;
+const float LIFETIME_MAX_ECCENTRICITY = 0.05f;
+const float LIFETIME_BALLISTIC = 2e-5f;       // Cd * A / m: orbits inside the atmosphere last tens to tens of thousands of revolutions
+
+// Kessler runs (--kessler <objects>): decades of a colliding, decaying population.
+// A year is as many revolutions as a real 400 km orbit makes in one, at that
+// altitude scaled to EARTH_RADIUS.
+const float KESSLER_YEARS = 50.f;             // default horizon
+const float KESSLER_STEP_DAYS = 5.f;          // warp step
+const float KESSLER_REPORT_DAYS = 91.f;       // between statistics rows
+const float KESSLER_MIN_ALTITUDE = 40.f;      // periapsis altitudes of the initial population
+const float KESSLER_MAX_ALTITUDE = 300.f;
+const float KESSLER_MAX_ECCENTRICITY = 0.02f;
+const float KESSLER_CELL = 2.f;               // collision sampling cube edge
+const float KESSLER_SATELLITE_RADIUS = 1.5f;  // m
+const float KESSLER_SATELLITE_AREA_TO_MASS = 0.01f; // m^2 / kg
+const float KESSLER_BALLISTIC_SCALE = 0.2f;   // drag coefficient per m^2 / kg (0.002 for a satellite)
+const float EARTH_RADIUS_METERS = 6.371e6f;
+const float KESSLER_REVS_PER_YEAR = 5680.f;   // 400 km orbit
+const float KESSLER_REFERENCE_ALTITUDE = 4e5f; // m
+
+// Live config (--config <file>): polled this often and re-read when it changes
+const int CONFIG_POLL_FRAMES = 30;
+
+// The constants above that a config file may override at runtime; the
+// interactive simulation reads these instead of the constants.
+static Tunables tunables = { G, EARTH_MASS, J2_STRENGTH, DRAG_BALLISTIC, ATMOSPHERE_SURFACE_DENSITY,
+                             MAX_DT, ORBIT_SPEED_SCALE, MAX_TRAIL };
+
+// Share of tunables.maxTrail the quality governor currently allows.
+static float trailFraction = 1.f;
+
+static float earthMu() { return tunables.g * tunables.earthMass; }
+
+static size_t trailLimit()
+{
+    return std::max(static_cast<size_t>(static_cast<float>(tunables.maxTrail) * trailFraction), size_t(16));
+}
+
+enum class Propagator
+{
+    Cowell,         // block-timestep Euler on the physical state
+    Regularized,    // Levi-Civita coordinates, uniform steps in fictitious time
+    Encke           // deviation from an analytically advanced Kepler orbit
+};
+
+// Which alternative propagators are enabled (each toggled at runtime)
+struct PropagatorModes
+{
+    bool regularized = false;
+    bool encke = false;
+};
+
 struct Satellite
 {
-    sf::CircleShape shape;
+    uint32_t id = 0;              // stable across removals, keys per-body caches; ascending in sats
+    sf::CircleShape shape;        // drawn at the state extrapolated to the frame time
+    sf::Vector2f position;
     sf::Vector2f velocity;
+    double epoch = 0.0;           // sim time the state refers to
+    int level = BLOCK_LEVELS - 1; // block timestep level
+    bool moved = false;           // stepped since the last trail sample
+    Propagator propagator = Propagator::Cowell;
+    LeviCivitaState reg;          // source of truth while propagator == Regularized
+    EnckeState encke;             // source of truth while propagator == Encke
     std::vector<sf::Vertex> trail;
+    OrbitInvariants reference;    // invariants at spawn, baseline for drift telemetry
+    Covariance covariance = Covariance::diagonal(UNCERTAINTY_POSITION, UNCERTAINTY_VELOCITY);
+    KeplerState covarianceState;  // state the covariance is centred on, relative to Earth
+    double covarianceEpoch = 0.0;
+    double reentryForecast = -1.0;  // last reported predicted surface contact time
     bool alive = true;
+
+    // lazy propagation state: frozen at epoch, orbit spans [lazyPeri, lazyApo]
+    bool lazy = false;
+    float lazyPeri = 0.f;
+    float lazyApo = 0.f;
 };
 
 static float length(const sf::Vector2f& v)
@@ -39,49 +234,1050 @@ static sf::Vector2f normalize(const sf::Vector2f& v)
     return v / m;
 }
 
-static float energy(const sf::Vector2f& pos, const sf::Vector2f& vel)
+static OrbitInvariants invariantsOf(const sf::Vector2f& pos, const sf::Vector2f& vel)
+{
+    return orbitInvariants(pos - EARTH_CENTER, vel, earthMu(), MIN_DIST);
+}
+
+// Snapshot all live satellites and push one drift sample to the reporter.
+static void publishTelemetry(const std::vector<Satellite>& sats, TelemetryBatch& batch, TelemetryRing& ring, size_t step)
+{
+    batch.clear();
+    for (const Satellite& sat : sats)
+    {
+        if (!sat.alive) continue;
+        batch.push(sat.position - EARTH_CENTER, sat.velocity, sat.reference);
+    }
+    ring.tryPush(reduceTelemetry(batch, earthMu(), MIN_DIST, step));
+}
+
+static void appendTrail(Satellite& sat, sf::Vector2f pos)
+{
+    // Trail: append, and remove excess in larger blocks to avoid O(n^2)
+    sat.trail.emplace_back(pos, sf::Color::Green);
+    if (sat.trail.size() > trailLimit())
+    {
+        // remove oldest block to amortize cost
+        size_t removeCount = sat.trail.size() - trailLimit();
+        if (removeCount < 16) removeCount = 16;
+        sat.trail.erase(sat.trail.begin(), sat.trail.begin() + static_cast<long>(removeCount));
+    }
+}
+
+static KeplerState keplerStateOf(const Satellite& sat)
+{
+    sf::Vector2f r = sat.position - EARTH_CENTER;
+    return { Vec2d(r.x, r.y), Vec2d(sat.velocity.x, sat.velocity.y) };
+}
+
+// World position of a point given relative to Earth.
+static sf::Vector2f worldPoint(Vec2d r)
+{
+    return EARTH_CENTER + sf::Vector2f(static_cast<float>(r.x), static_cast<float>(r.y));
+}
+
+static const EventSpec& earthEvents()
+{
+    static const EventSpec spec = { EARTH_RADIUS, { EARTH_RADIUS + LOW_ALTITUDE }, true };
+    return spec;
+}
+
+// Events between two states of one body. An impact retires the body at the
+// exact contact point instead of wherever the step happened to land.
+static void stepEvents(Satellite& sat, const KeplerState& before, double t0, const KeplerState& after, double t1, std::vector<OrbitEvent>& events)
+{
+    size_t first = events.size();
+    bool impact = detectEvents({ t0, t1, before, after }, earthEvents(), events);
+    for (size_t k = first; k < events.size(); ++k) events[k].body = sat.id;
+    if (!impact) return;
+
+    const OrbitEvent& hit = events.back();
+    sat.position = worldPoint(hit.state.r);
+    sat.velocity = { static_cast<float>(hit.state.v.x), static_cast<float>(hit.state.v.y) };
+    sat.epoch = hit.t;
+    sat.alive = false;
+}
+
+// True if the annulus [rMin, rMax] around Earth overlaps the (padded) view.
+static bool orbitTouchesView(float rMin, float rMax, const sf::View& view)
+{
+    sf::Vector2f half = view.getSize() * 0.5f + sf::Vector2f(LAZY_VIEW_MARGIN, LAZY_VIEW_MARGIN);
+    sf::Vector2f d = view.getCenter() - EARTH_CENTER;
+
+    // nearest and farthest points of the rectangle from Earth's center
+    float nx = std::max(std::abs(d.x) - half.x, 0.f);
+    float ny = std::max(std::abs(d.y) - half.y, 0.f);
+    float fx = std::abs(d.x) + half.x;
+    float fy = std::abs(d.y) + half.y;
+    float nearest = std::sqrt(nx * nx + ny * ny);
+    float farthest = std::sqrt(fx * fx + fy * fy);
+    return rMin <= farthest && rMax >= nearest;
+}
+
+// Freeze a body if its orbit can neither be seen nor reach the screening altitude.
+static void tryFreeze(Satellite& sat, const sf::View& view)
+{
+    ConicBounds b = conicBounds(keplerStateOf(sat), earthMu());
+    // analytic catch-up has no drag, so the whole orbit must stay above the atmosphere
+    if (!b.bound || b.periapsis < EARTH_RADIUS + std::max(LAZY_SCREEN_MARGIN, ATMOSPHERE_CEILING)) return;
+    if (orbitTouchesView(static_cast<float>(b.periapsis), static_cast<float>(b.apoapsis), view)) return;
+
+    sat.lazy = true;
+    sat.lazyPeri = static_cast<float>(b.periapsis);
+    sat.lazyApo = static_cast<float>(b.apoapsis);
+}
+
+// Every table built so far, newest last. Older ones stay alive because an
+// ephemeris fit in flight may still hold a ForceModel pointing at one.
+static std::deque<DensityTable>& atmosphereTables()
+{
+    static std::deque<DensityTable> tables = { makeDensityTable(EARTH_RADIUS, tunables.surfaceDensity) };
+    return tables;
+}
+
+static const DensityTable& earthAtmosphere()
+{
+    return atmosphereTables().back();
+}
+
+static ForceModel earthForce()
+{
+    return { EARTH_CENTER, earthMu(), tunables.j2, MIN_DIST, &earthAtmosphere(), tunables.dragBallistic, {} };
+}
+
+// Moon first (it is drawn), then the Sun, both counter-clockwise from epoch 0.
+static ThirdBodies makeThirdBodies()
+{
+    auto tabulate = [](float mass, float distance, double angle)
+    {
+        const double muPair = tunables.g * (tunables.earthMass + mass);
+        Vec2d dir(std::cos(angle), std::sin(angle));
+        KeplerState start = { dir * static_cast<double>(distance), Vec2d(-dir.y, dir.x) * std::sqrt(muPair / distance) };
+        return tabulateBody(tunables.g * mass, start, muPair, THIRD_BODY_SAMPLES);
+    };
+    ThirdBodies b;
+    b.tables.push_back(tabulate(MOON_MASS, MOON_DISTANCE, 0.0));
+    b.tables.push_back(tabulate(SUN_MASS, SUN_DISTANCE, -0.5 * KEPLER_PI));
+    return b;
+}
+
+// Only read on the main thread, so a reload can rebuild it in place.
+static ThirdBodies& earthThirdBodies()
+{
+    static ThirdBodies bodies = makeThirdBodies();
+    return bodies;
+}
+
+// Re-centre the covariance on the current state (at spawn and after a burn).
+static void anchorCovariance(Satellite& sat)
+{
+    sat.covarianceState = keplerStateOf(sat);
+    sat.covarianceEpoch = sat.epoch;
+}
+
+// Carry the covariance from its anchor to the body's current epoch.
+static void advanceCovariance(Satellite& sat, const ThirdBodies* thirdBodies)
+{
+    KeplerState mean = sat.covarianceState;
+    propagateUnscented(earthForce(), thirdBodies, mean, sat.covariance, sat.epoch - sat.covarianceEpoch, tickDt(),
+        sat.covarianceEpoch);
+    anchorCovariance(sat);
+}
+
+// Uncertainty ellipses ahead of the body over the ghost-path horizon.
+static std::vector<UncertaintyEllipse> predictUncertainty(Satellite& sat, const ThirdBodies* thirdBodies)
+{
+    advanceCovariance(sat, thirdBodies);
+    std::vector<UncertaintyEllipse> ellipses;
+    KeplerState mean = sat.covarianceState;
+    Covariance p = sat.covariance;
+    propagateUnscented(earthForce(), thirdBodies, mean, p, UNCERTAINTY_HORIZON, tickDt(),
+        sat.epoch, UNCERTAINTY_SPACING, UNCERTAINTY_SIGMAS, &ellipses, EARTH_RADIUS);
+    return ellipses;
+}
+
+// Level for a body entering the block scheme at this tick (spawn or wake).
+static int entryLevel(const Satellite& sat, uint64_t tick)
 {
-    float r = std::max(length(pos), MIN_DIST);
-    float KE = 0.5f * (vel.x * vel.x + vel.y * vel.y);
-    float PE = -G * EARTH_MASS / r;
-    return KE + PE;
+    int level = accuracyLevel(length(sat.position - EARTH_CENTER), length(sat.velocity), earthMu());
+    return std::max(level, alignedLevel(tick));
 }
 
-static std::vector<sf::Vertex> predictOrbit(sf::Vector2f pos, sf::Vector2f vel, float dt = 0.02f, int steps = 400)
+// Bring a body that left the block grid (frozen or regularized) back onto it at
+// the current block time, advancing analytically and filling in its trail.
+static void rejoinGrid(Satellite& sat, const BlockClock& clock)
+{
+    KeplerState s0 = keplerStateOf(sat);
+    double elapsed = clock.blockTime() - sat.epoch;
+    const double mu = earthMu();
+
+    int samples = std::clamp(static_cast<int>(elapsed / tunables.maxDt), 1, LAZY_TRAIL_SAMPLES);
+    KeplerState s = s0;
+    for (int k = 1; k <= samples; ++k)
+    {
+        s = keplerPropagate(s0, elapsed * k / samples, mu);
+        appendTrail(sat, worldPoint(s.r));
+    }
+
+    sat.position = worldPoint(s.r);
+    sat.velocity = { static_cast<float>(s.v.x), static_cast<float>(s.v.y) };
+    sat.epoch = clock.blockTime();
+    sat.level = entryLevel(sat, clock.tick);
+    sat.propagator = Propagator::Cowell;
+    sat.lazy = false;
+}
+
+static Vec2d earthPerturbation(Vec2d x, Vec2d v)
+{
+    // the block kernel's terms other than central gravity, relative to Earth
+    return ForceSum<TangentialDrift, AtmosphericDrag>::at(earthForce(), x, v);
+}
+
+// Eccentric bodies go to the regularized propagator, weakly perturbed ones to
+// Encke, everything else stays on the block grid.
+static Propagator preferredPropagator(const Satellite& sat, const PropagatorModes& modes)
+{
+    if (modes.regularized && invariantsOf(sat.position, sat.velocity).eccentricity > REG_MIN_ECCENTRICITY)
+        return Propagator::Regularized;
+
+    if (modes.encke)
+    {
+        // J2 drift grows as r while gravity falls as 1/r^2
+        float r = length(sat.position - EARTH_CENTER);
+        if (tunables.j2 * r * r * r / earthMu() < ENCKE_MAX_PERTURBATION)
+            return Propagator::Encke;
+    }
+    return Propagator::Cowell;
+}
+
+static void choosePropagator(Satellite& sat, const PropagatorModes& modes, const BlockClock& clock)
+{
+    Propagator want = preferredPropagator(sat, modes);
+    if (want == sat.propagator) return;
+
+    if (sat.propagator != Propagator::Cowell) rejoinGrid(sat, clock);
+
+    KeplerState s = keplerStateOf(sat);
+    if (want == Propagator::Regularized) sat.reg = toLeviCivita(s.r, s.v, earthMu(), sat.epoch);
+    if (want == Propagator::Encke) sat.encke = startEncke(s, sat.epoch);
+    sat.propagator = want;
+}
+
+// Regularized bodies take uniform fictitious-time steps until they reach the
+// block time. They may end slightly past it and are extrapolated when drawn.
+static void advanceRegularized(std::vector<Satellite>& sats, const BlockClock& clock, const ThirdBodyField& bodies,
+    std::vector<OrbitEvent>& events)
+{
+    const double target = clock.blockTime();
+    auto perturb = [&bodies](Vec2d x, Vec2d v) { return earthPerturbation(x, v) + thirdBodyAcceleration(bodies, x); };
+    for (Satellite& sat : sats)
+    {
+        if (!sat.alive || sat.lazy || sat.propagator != Propagator::Regularized) continue;
+        if (sat.reg.t >= target) continue;
+
+        KeplerState s;
+        fromLeviCivita(sat.reg, s.r, s.v);
+        for (int n = 0; n < REG_MAX_STEPS_PER_FRAME && sat.alive && sat.reg.t < target; ++n)
+        {
+            KeplerState before = s;
+            double t0 = sat.reg.t;
+            stepLeviCivita(sat.reg, regularizedStep(sat.reg), perturb);
+            fromLeviCivita(sat.reg, s.r, s.v);
+            stepEvents(sat, before, t0, s, sat.reg.t, events);
+        }
+
+        sat.moved = true;
+        if (!sat.alive) continue;
+
+        sat.position = worldPoint(s.r);
+        sat.velocity = { static_cast<float>(s.v.x), static_cast<float>(s.v.y) };
+        sat.epoch = sat.reg.t;
+    }
+}
+
+// Encke bodies step their deviation in large fixed steps up to the block time;
+// the displayed state is the exact reference at that time plus the deviation.
+static void advanceEncke(std::vector<Satellite>& sats, const BlockClock& clock, const ThirdBodyField& bodies,
+    std::vector<OrbitEvent>& events)
+{
+    const double target = clock.blockTime();
+    const double mu = earthMu();
+    auto perturb = [&bodies](Vec2d x, Vec2d v) { return earthPerturbation(x, v) + thirdBodyAcceleration(bodies, x); };
+    for (Satellite& sat : sats)
+    {
+        if (!sat.alive || sat.lazy || sat.propagator != Propagator::Encke) continue;
+        if (sat.epoch >= target) continue;
+
+        for (int n = 0; n < ENCKE_MAX_STEPS_PER_FRAME && sat.alive; ++n)
+        {
+            double h = enckeStep(sat.encke, mu);
+            if (sat.encke.t + h > target) break;
+            double t0 = sat.encke.t;
+            KeplerState before = enckeState(sat.encke, t0, mu);
+            stepEncke(sat.encke, h, mu, perturb);
+            stepEvents(sat, before, t0, enckeState(sat.encke, sat.encke.t, mu), sat.encke.t, events);
+        }
+
+        sat.moved = true;
+        if (!sat.alive) continue;
+
+        // the partial step up to the target is checked when it is actually taken
+        KeplerState s = enckeState(sat.encke, target, mu);
+        sat.position = worldPoint(s.r);
+        sat.velocity = { static_cast<float>(s.v.x), static_cast<float>(s.v.y) };
+        sat.epoch = target;
+
+        if (norm(s.r) <= EARTH_RADIUS) sat.alive = false;
+    }
+}
+
+// Satellites are appended with increasing ids and removed in place, so the
+// vector stays sorted by id.
+static Satellite* findSatellite(std::vector<Satellite>& sats, uint32_t id)
+{
+    auto it = std::lower_bound(sats.begin(), sats.end(), id,
+        [](const Satellite& sat, uint32_t key) { return sat.id < key; });
+    return it != sats.end() && it->id == id ? &*it : nullptr;
+}
+
+// One semi-implicit Euler step of the full force model from time `from` to
+// `to` (may run backwards), with the third bodies, if given, taken at `from`.
+static void coast(Satellite& sat, double from, double to, const ThirdBodies* thirdBodies)
+{
+    ForceModel force = earthForce();
+    if (thirdBodies) force.bodies = thirdBodies->at(from);
+    const double dt = to - from;
+    KeplerState s = keplerStateOf(sat);
+    s.v += accelerationAt(force, s.r, s.v) * dt;
+    s.r += s.v * dt;
+    sat.position = worldPoint(s.r);
+    sat.velocity = { static_cast<float>(s.v.x), static_cast<float>(s.v.y) };
+}
+
+// Fire every burn due by the current block time. The body is brought to the
+// burn time, given its velocity change, then brought back to the block time and
+// re-enters the grid at this tick. Returns true if any body was burned.
+static bool applyManeuvers(std::vector<Satellite>& sats, const BlockClock& clock, const ThirdBodies* thirdBodies,
+    ManeuverTimeline& timeline, std::vector<uint32_t>& burned)
+{
+    bool any = false;
+    while (timeline.due(clock.blockTime()))
+    {
+        Maneuver m = timeline.pop();
+        Satellite* sat = findSatellite(sats, m.body);
+        if (!sat || !sat->alive) continue;   // gone; the rest of a finite burn is dropped too
+
+        if (sat->lazy || sat->propagator != Propagator::Cowell) rejoinGrid(*sat, clock);
+
+        coast(*sat, sat->epoch, m.t, thirdBodies);
+        Vec2d dv = timeline.fire(m, keplerStateOf(*sat));
+        sat->velocity += sf::Vector2f(static_cast<float>(dv.x), static_cast<float>(dv.y));
+        coast(*sat, m.t, clock.blockTime(), thirdBodies);
+
+        sat->epoch = clock.blockTime();
+        sat->level = entryLevel(*sat, clock.tick);
+        sat->reference = invariantsOf(sat->position, sat->velocity);   // drift is measured from the new orbit
+        sat->moved = true;
+        if (length(sat->position - EARTH_CENTER) <= EARTH_RADIUS) sat->alive = false;
+
+        if (burned.empty() || burned.back() != m.body) burned.push_back(m.body);
+        any = true;
+    }
+    return any;
+}
+
+using BlockLevels = std::array<std::vector<int>, BLOCK_LEVELS>;
+
+static void sortIntoLevels(const std::vector<Satellite>& sats, BlockLevels& levels)
+{
+    for (auto& bucket : levels) bucket.clear();
+    for (int i = 0; i < static_cast<int>(sats.size()); ++i)
+        if (sats[i].alive && !sats[i].lazy && sats[i].propagator == Propagator::Cowell) levels[sats[i].level].push_back(i);
+}
+
+// Run every whole tick accumulated in the clock. Each level is gathered into
+// a batch and stepped together when its grid comes due; afterwards bodies may
+// move to a finer level at once, or one level coarser if the grid allows it.
+// Burns due at a tick are fired after the levels have stepped. Third bodies,
+// if given, are interpolated once per tick and shared by every level.
+static void advanceBlocks(std::vector<Satellite>& sats, BlockLevels& levels, BlockClock& clock, BodyBatch& batch,
+    const ThirdBodies* thirdBodies, ManeuverTimeline& timeline, std::vector<uint32_t>& burned, std::vector<OrbitEvent>& events)
+{
+    ForceModel force = earthForce();
+    const double tick = tickDt();
+
+    while (clock.pending >= tick)
+    {
+        if (thirdBodies) force.bodies = thirdBodies->at(clock.blockTime());
+        clock.pending -= tick;
+        ++clock.tick;
+        bool relevel = false;
+
+        for (int level = 0; level < BLOCK_LEVELS; ++level)
+        {
+            const std::vector<int>& bucket = levels[level];
+            if (bucket.empty() || !levelDue(level, clock.tick)) continue;
+
+            batch.clear();
+            for (int i : bucket) batch.push(sats[i].position, sats[i].velocity);
+            stepBatch(force, batch, blockDt(level));
+
+            for (size_t k = 0; k < bucket.size(); ++k)
+            {
+                Satellite& sat = sats[bucket[k]];
+                KeplerState before = keplerStateOf(sat);
+                double t0 = sat.epoch;
+                sat.position = { batch.px[k], batch.py[k] };
+                sat.velocity = { batch.vx[k], batch.vy[k] };
+                sat.epoch = clock.blockTime();
+                sat.moved = true;
+
+                stepEvents(sat, before, t0, keplerStateOf(sat), sat.epoch, events);
+                if (!sat.alive)
+                {
+                    relevel = true;
+                    continue;
+                }
+
+                float dist = length(sat.position - EARTH_CENTER);
+
+                int next = std::max(accuracyLevel(dist, length(sat.velocity), force.mu), level - 1);
+                next = std::max(next, alignedLevel(clock.tick));
+                if (next != level)
+                {
+                    sat.level = next;
+                    relevel = true;
+                }
+            }
+        }
+
+        if (applyManeuvers(sats, clock, thirdBodies, timeline, burned)) relevel = true;
+        if (relevel) sortIntoLevels(sats, levels);
+    }
+}
+
+// Ghost path integrated from the body's state at time t; third bodies, if
+// given, are sampled every step.
+static std::vector<sf::Vertex> predictOrbit(sf::Vector2f pos, sf::Vector2f vel, double t, const ThirdBodies* thirdBodies,
+    float dt = 0.02f, int steps = 400)
 {
     std::vector<sf::Vertex> ghost;
     ghost.reserve(steps);
 
     sf::Vector2f p = pos;
     sf::Vector2f v = vel;
+    ForceModel force = earthForce();
+    const EventSpec surface = { EARTH_RADIUS, {}, false };
+    std::vector<OrbitEvent> contact;
 
     for (int i = 0; i < steps; ++i)
     {
-        sf::Vector2f toEarth = -p;
-        float dist = length(toEarth);
-        if (dist <= EARTH_RADIUS) break; // stop prediction when intersecting Earth
-
-        sf::Vector2f dir = normalize(toEarth);
-
-        float accel = G * EARTH_MASS / (dist * dist + MIN_DIST); // protect divide by zero
-        sf::Vector2f a = dir * accel;
-
-        // simple J2 fake perturbation drift (kept as a small hack)
-        sf::Vector2f tangent = { -dir.y, dir.x };
-        a += tangent * J2_STRENGTH * dist;
+        if (thirdBodies) force.bodies = thirdBodies->at(t + dt * i);
+        sf::Vector2f p0 = p - EARTH_CENTER, v0 = v;
+        Vec2d a = accelerationAt(force, Vec2d(p0.x, p0.y), Vec2d(v.x, v.y));
 
         // integrate with dt (semi-explicit Euler)
-        v += a * dt;
+        v += sf::Vector2f(static_cast<float>(a.x), static_cast<float>(a.y)) * dt;
         p += v * dt;
 
+        // stop prediction exactly where the path meets Earth
+        sf::Vector2f p1 = p - EARTH_CENTER;
+        KeplerState before = { Vec2d(p0.x, p0.y), Vec2d(v0.x, v0.y) };
+        KeplerState after = { Vec2d(p1.x, p1.y), Vec2d(v.x, v.y) };
+        if (detectEvents({ 0.0, dt, before, after }, surface, contact))
+        {
+            ghost.emplace_back(worldPoint(contact.back().state.r), sf::Color(200, 200, 255, 120));
+            break;
+        }
+
         ghost.emplace_back(p, sf::Color(200, 200, 255, 120));
     }
 
     return ghost;
 }
 
-int main()
+// Ghost path sampled from a cached ephemeris: no integration at all.
+static std::vector<sf::Vertex> ghostFromEphemeris(const Ephemeris& e, double t, float dt = 0.02f, int steps = 400)
 {
+    std::vector<sf::Vertex> ghost;
+    ghost.reserve(steps);
+    for (int i = 1; i <= steps; ++i)
+    {
+        double ti = t + dt * i;
+        if (ti > e.end())
+        {
+            // end on the contact point rather than short of it
+            if (e.impact) ghost.emplace_back(worldPoint(e.position(e.end())), sf::Color(200, 200, 255, 120));
+            break;
+        }
+        ghost.emplace_back(worldPoint(e.position(ti)), sf::Color(200, 200, 255, 120));
+    }
+    return ghost;
+}
+
+// Record this frame's events for the markers; impacts are also logged.
+static void logEvents(const std::vector<OrbitEvent>& events, std::deque<OrbitEvent>& log)
+{
+    for (const OrbitEvent& e : events)
+    {
+        if (e.kind == EventKind::Impact)
+            std::cout << "satellite " << e.body << " impact at t=" << e.t << '\n';
+        log.push_back(e);
+    }
+    while (log.size() > EVENT_LOG_SIZE) log.pop_front();
+}
+
+// Small crosses at recent event points, fading with age.
+static void drawEventMarkers(sf::RenderTarget& target, const std::deque<OrbitEvent>& log, double simTime)
+{
+    std::vector<sf::Vertex> lines;
+    lines.reserve(log.size() * 4);
+    for (const OrbitEvent& e : log)
+    {
+        float age = static_cast<float>(simTime - e.t) / EVENT_MARKER_SECONDS;
+        if (age >= 1.f) continue;
+
+        sf::Color color = sf::Color::White;
+        if (e.kind == EventKind::Impact) color = sf::Color::Red;
+        if (e.kind == EventKind::Periapsis) color = sf::Color(255, 160, 0);
+        if (e.kind == EventKind::Apoapsis) color = sf::Color::Cyan;
+        color.a = static_cast<std::uint8_t>(255.f * (1.f - std::max(age, 0.f)));
+
+        sf::Vector2f p = worldPoint(e.state.r);
+        const float s = 4.f;
+        lines.push_back({ p + sf::Vector2f(-s, -s), color });
+        lines.push_back({ p + sf::Vector2f(s, s), color });
+        lines.push_back({ p + sf::Vector2f(-s, s), color });
+        lines.push_back({ p + sf::Vector2f(s, -s), color });
+    }
+    if (!lines.empty())
+        target.draw(lines.data(), lines.size(), sf::PrimitiveType::Lines);
+}
+
+// Ellipses still ahead of the current time, as one line batch of `segments` per ellipse.
+static void drawUncertainty(sf::RenderTarget& target, const std::vector<UncertaintyEllipse>& ellipses, double simTime,
+    int segments = UNCERTAINTY_SEGMENTS)
+{
+    std::vector<sf::Vertex> lines;
+    lines.reserve(ellipses.size() * segments * 2);
+    const sf::Color color(255, 200, 120, 140);
+    for (const UncertaintyEllipse& e : ellipses)
+    {
+        if (e.t < simTime) continue;
+
+        double c = std::cos(e.angle), s = std::sin(e.angle);
+        auto point = [&](int k)
+        {
+            double u = 2.0 * KEPLER_PI * k / segments;
+            double x = e.major * std::cos(u), y = e.minor * std::sin(u);
+            return worldPoint(e.center + Vec2d(c * x - s * y, s * x + c * y));
+        };
+        for (int k = 0; k < segments; ++k)
+        {
+            lines.push_back({ point(k), color });
+            lines.push_back({ point(k + 1), color });
+        }
+    }
+    if (!lines.empty())
+        target.draw(lines.data(), lines.size(), sf::PrimitiveType::Lines);
+}
+
+// Refit every cached prediction under the current force, with the tides while
+// they are on. The fitter gets its own copy of the tables, since a reload
+// rebuilds them in place. Forecasts made under the old force are dropped.
+static void refitEphemerides(EphemerisCache& ephemerides, bool thirdBodiesOn, std::vector<Satellite>& sats)
+{
+    ephemerides.setForce(earthForce(), thirdBodiesOn ? std::make_shared<const ThirdBodies>(earthThirdBodies()) : nullptr);
+    for (Satellite& sat : sats) sat.reentryForecast = -1.0;
+}
+
+// Swap in new tunables and rebuild only what depends on the ones that changed.
+// Off-grid bodies rejoin the block grid under the old force first, since their
+// propagator states were set up with it.
+static uint32_t applyTunables(const Tunables& next, std::vector<Satellite>& sats, const BlockClock& clock,
+    EphemerisCache& ephemerides, bool thirdBodiesOn)
+{
+    const uint32_t effects = tunableEffects(tunables, next);
+    if (effects & TUNE_FORCE)
+        for (Satellite& sat : sats)
+            if (sat.alive && (sat.lazy || sat.propagator != Propagator::Cowell)) rejoinGrid(sat, clock);
+
+    tunables = next;
+
+    if (effects & TUNE_ATMOSPHERE)
+        atmosphereTables().push_back(makeDensityTable(EARTH_RADIUS, tunables.surfaceDensity));
+    if (effects & TUNE_FORCE)
+    {
+        earthThirdBodies() = makeThirdBodies();
+        refitEphemerides(ephemerides, thirdBodiesOn, sats);
+        for (Satellite& sat : sats) sat.reference = invariantsOf(sat.position, sat.velocity);
+    }
+    if (effects & TUNE_TRAIL)
+    {
+        for (Satellite& sat : sats)
+            if (sat.trail.size() > trailLimit())
+                sat.trail.erase(sat.trail.begin(), sat.trail.end() - static_cast<long>(trailLimit()));
+    }
+    return effects;
+}
+
+enum class ShellView : uint8_t { Off, Equatorial, Orbital };
+
+static ZonalModel earthZonals()
+{
+    return makeZonalModel(earthMu(), EARTH_RADIUS, ZONAL_DEGREE);
+}
+
+// Circular orbits with nodes and phases spread by the golden angle, so any
+// prefix of the shell covers the sphere evenly.
+static void fillZonalShell(BodyBatch3& shell, size_t count, double inclinationDeg)
+{
+    const double golden = KEPLER_PI * (3.0 - std::sqrt(5.0));
+    const double inclination = inclinationDeg * KEPLER_PI / 180.0;
+    shell.clear();
+    for (size_t k = 0; k < count; ++k)
+    {
+        double radius = EARTH_RADIUS + ZONAL_SHELL_ALTITUDE + ZONAL_SHELL_SPREAD * (k % 64) / 64.0;
+        Vec3d r, v;
+        circularOrbit3(earthMu(), radius, inclination, golden * k, 0.5 * golden * k * k, r, v);
+        shell.push(r, v);
+    }
+}
+
+// One generator by name, "walker", "shell" or "debris", with an optional count
+// after a colon ("shell:1000000"). Debris is released around the first
+// satellite. Returns the number of bodies added.
+static size_t spawnSwarm(Swarm& swarm, const std::string& item, const std::vector<Satellite>& sats, uint64_t seed, float now)
+{
+    size_t colon = item.find(':');
+    std::string name = item.substr(0, colon);
+    size_t count = colon == std::string::npos ? SWARM_SPAWN_COUNT : std::strtoull(item.c_str() + colon + 1, nullptr, 10);
+    const size_t before = swarm.size();
+
+    if (name == "walker")
+    {
+        WalkerSpec w;
+        w.total = colon == std::string::npos ? WALKER_TOTAL : static_cast<int>(count);
+        w.planes = WALKER_PLANES;
+        w.phasing = WALKER_PHASING;
+        w.radius = EARTH_RADIUS + WALKER_ALTITUDE;
+        w.spacing = WALKER_SPACING;
+        w.mass = WALKER_MASS;
+        spawnWalker(swarm, w, EARTH_CENTER, earthMu(), now);
+    }
+    else if (name == "shell")
+    {
+        spawnShell(swarm, count, EARTH_RADIUS + SHELL_MIN_ALTITUDE, EARTH_RADIUS + SHELL_MAX_ALTITUDE,
+            SHELL_MAX_ECCENTRICITY, SHELL_MASS, seed, EARTH_CENTER, earthMu(), now);
+    }
+    else if (name == "debris" && !sats.empty())
+    {
+        spawnDebris(swarm, count, keplerStateOf(sats[0]), DEBRIS_SIGMA_POSITION, DEBRIS_SIGMA_VELOCITY, DEBRIS_MASS, seed,
+            EARTH_CENTER, now);
+    }
+    else
+    {
+        std::cout << "swarm: cannot spawn '" << item << "'\n";
+    }
+    return swarm.size() - before;
+}
+
+static void drawSwarm(sf::RenderTarget& target, const Swarm& swarm, std::vector<sf::Vertex>& points)
+{
+    if (swarm.size() == 0) return;
+    const sf::Color colors[] = { sf::Color(255, 220, 120), sf::Color(140, 180, 255), sf::Color(255, 120, 90), sf::Color(230, 230, 230) };
+
+    points.resize(swarm.size());
+    size_t k = 0;
+    for (const auto& block : swarm.blocks)
+    {
+        for (size_t i = 0; i < block->size(); ++i, ++k)
+        {
+            points[k].position = { block->bodies.px[i], block->bodies.py[i] };
+            points[k].color = colors[static_cast<int>(block->kind[i])];
+        }
+    }
+    target.draw(points.data(), points.size(), sf::PrimitiveType::Points);
+}
+
+// Grid handles: swarm bodies by block and slot, satellites by index with the top bit set.
+const uint32_t SATELLITE_HANDLE = 0x80000000u;
+
+// Break up every pair of bodies in contact. Swarm bodies take part once
+// armed, satellites while alive and stepped (lazy ones are not where they are
+// drawn). Satellites on coarse levels are brought from their epoch to simTime,
+// where the swarm is. Both partners are retired and their combined mass and
+// momentum go into an SBM fragment cloud in the swarm; swarm partners are
+// parked for the next cull, so slots stay valid while fragments are appended.
+// Returns the number of collisions.
+static size_t collideBodies(Swarm& swarm, std::vector<Satellite>& sats, double simTime, uint64_t seed, uint32_t& events,
+    CollisionGrid& grid, std::vector<std::pair<uint32_t, uint32_t>>& pairs)
+{
+    const double mu = earthMu();
+    auto stateNow = [&](const Satellite& sat) { return keplerPropagate(keplerStateOf(sat), simTime - sat.epoch, mu); };
+
+    grid.clear();
+    for (size_t b = 0; b < swarm.blocks.size(); ++b)
+    {
+        const SwarmBlock& block = *swarm.blocks[b];
+        for (size_t i = 0; i < block.size(); ++i)
+            if (block.armed[i] <= simTime)
+                grid.add(block.bodies.px[i], block.bodies.py[i], static_cast<uint32_t>(b * SWARM_BLOCK + i));
+    }
+    for (size_t i = 0; i < sats.size(); ++i)
+    {
+        if (!sats[i].alive || sats[i].lazy) continue;
+        const sf::Vector2f p = worldPoint(stateNow(sats[i]).r);
+        grid.add(p.x, p.y, SATELLITE_HANDLE | static_cast<uint32_t>(i));
+    }
+    grid.pairs(COLLISION_DISTANCE, pairs);
+
+    // state relative to Earth and mass of one partner, which is retired
+    auto take = [&](uint32_t h, KeplerState& s) -> double
+    {
+        if (h & SATELLITE_HANDLE)
+        {
+            Satellite& sat = sats[h & ~SATELLITE_HANDLE];
+            s = stateNow(sat);
+            sat.alive = false;
+            std::cout << "satellite " << sat.id << " destroyed in a collision at t=" << simTime << '\n';
+            return SATELLITE_MASS;
+        }
+        size_t b = h / SWARM_BLOCK, i = h % SWARM_BLOCK;
+        const BodyBatch& body = swarm.blocks[b]->bodies;
+        s = { Vec2d(body.px[i] - EARTH_CENTER.x, body.py[i] - EARTH_CENTER.y), Vec2d(body.vx[i], body.vy[i]) };
+        double mass = swarm.blocks[b]->mass[i];
+        swarm.remove(b, i, EARTH_CENTER);
+        return mass;
+    };
+
+    const float armed = static_cast<float>(simTime) + FRAGMENT_ARM_TIME;
+    for (const auto& [a, b] : pairs)
+    {
+        KeplerState sa, sb;
+        double ma = take(a, sa), mb = take(b, sb);
+        double total = ma + mb;
+        KeplerState center = { (sa.r * ma + sb.r * mb) / total, (sa.v * ma + sb.v * mb) / total };
+        double speed = norm(sa.v - sb.v) / BREAKUP_SPEED_SCALE;
+        spawnBreakup(swarm, center, total, breakupMass(ma, mb, speed), seed, events++, EARTH_CENTER, armed);
+    }
+    return pairs.size();
+}
+
+// Shell bodies as points in the chosen plane, around the drawn Earth.
+static void drawZonalShell(sf::RenderTarget& target, const BodyBatch3& shell, ShellView mode, std::vector<sf::Vertex>& points)
+{
+    if (mode == ShellView::Off || shell.size() == 0) return;
+    ViewPlane plane = mode == ShellView::Orbital ? orbitalPlane(shell.position(0), shell.velocity(0)) : ViewPlane();
+
+    points.resize(shell.size());
+    for (size_t i = 0; i < shell.size(); ++i)
+    {
+        points[i].position = worldPoint(plane.project(shell.position(i)));
+        points[i].color = i == 0 ? sf::Color::Yellow : sf::Color(120, 200, 255);
+    }
+    target.draw(points.data(), points.size(), sf::PrimitiveType::Points);
+}
+
+// Transfer window from the first to the second satellite, both brought to the
+// current block time.
+static PorkchopSpec porkchopSpec(const Satellite& from, const Satellite& to, const BlockClock& clock)
+{
+    const double mu = earthMu();
+    const double now = clock.blockTime();
+
+    PorkchopSpec spec;
+    spec.from = keplerPropagate(keplerStateOf(from), now - from.epoch, mu);
+    spec.to = keplerPropagate(keplerStateOf(to), now - to.epoch, mu);
+    spec.epoch = now;
+    spec.mu = mu;
+    spec.minPeriapsis = EARTH_RADIUS;
+
+    double a = 0.5 * (norm(spec.from.r) + norm(spec.to.r));
+    double transfer = 2.0 * KEPLER_PI * std::sqrt(a * a * a / mu);
+    spec.departSpan = std::max(orbitTimescale(spec.from, mu), orbitTimescale(spec.to, mu));
+    spec.arriveMin = now + PORKCHOP_MIN_TOF * transfer;
+    spec.arriveMax = now + spec.departSpan + transfer;
+    return spec;
+}
+
+// Starter satellite state relative to Earth; speedScale multiplies the circular speed.
+static KeplerState starterState(float speedScale)
+{
+    sf::Vector2f r = sf::Vector2f(350.f, 0.f) - EARTH_CENTER;
+    return { Vec2d(r.x, r.y), Vec2d(0.0, std::sqrt(earthMu() / 350.f) * speedScale) };
+}
+
+// Value following flag on the command line, or null.
+static const char* argValue(int argc, char** argv, const char* flag)
+{
+    for (int i = 1; i + 1 < argc; ++i)
+        if (std::string(argv[i]) == flag) return argv[i + 1];
+    return nullptr;
+}
+
+// --ensemble <members> [--seed k] [--duration s] [--sigma-pos p] [--sigma-vel v] [--speed scale] [--ballistic b]
+static int runEnsembleCommand(int argc, char** argv, const char* members)
+{
+    auto number = [&](const char* flag, double fallback)
+    {
+        const char* v = argValue(argc, argv, flag);
+        return v ? std::strtod(v, nullptr) : fallback;
+    };
+
+    EnsembleSpec spec;
+    spec.members = std::strtoull(members, nullptr, 10);
+    spec.seed = static_cast<uint64_t>(number("--seed", 1.0));
+    spec.duration = number("--duration", HEADLESS_DURATION);
+    spec.sigmaPosition = number("--sigma-pos", ENSEMBLE_SIGMA_POSITION);
+    spec.sigmaVelocity = number("--sigma-vel", ENSEMBLE_SIGMA_VELOCITY);
+    spec.base = starterState(static_cast<float>(number("--speed", ORBIT_SPEED_SCALE)));
+    spec.dt = tickDt();
+    spec.surfaceRadius = EARTH_RADIUS;
+    spec.escapeRadius = HEADLESS_ESCAPE_RADIUS;
+    if (spec.members == 0 || !(spec.duration > 0.0))
+    {
+        std::cout << "ensemble: need a positive member count and duration\n";
+        return 1;
+    }
+
+    ForceModel force = earthForce();
+    force.ballistic = static_cast<float>(number("--ballistic", DRAG_BALLISTIC));
+
+    unsigned threads = std::max(std::thread::hardware_concurrency(), 1u);
+    EnsembleStats stats = runEnsemble(spec, force, threads);
+    printEnsemble(spec, stats);
+    return 0;
+}
+
+// --sweep <table.csv | -> [--g r] [--mass r] [--j2 r] [--speed r] [--max-dt r] [--duration s]
+// where each range r is "value" or "lo:hi:count"; unset ones keep the compiled-in constant
+static int runSweepCommand(int argc, char** argv, const char* table)
+{
+    SweepSpec spec;
+    spec.g = { G, G, 1 };
+    spec.mass = { EARTH_MASS, EARTH_MASS, 1 };
+    spec.j2 = { J2_STRENGTH, J2_STRENGTH, 1 };
+    spec.speedScale = { ORBIT_SPEED_SCALE, ORBIT_SPEED_SCALE, 1 };
+    spec.maxDt = { MAX_DT, MAX_DT, 1 };
+
+    const std::pair<const char*, SweepRange*> ranges[] = {
+        { "--g", &spec.g }, { "--mass", &spec.mass }, { "--j2", &spec.j2 },
+        { "--speed", &spec.speedScale }, { "--max-dt", &spec.maxDt }
+    };
+    for (const auto& [flag, range] : ranges)
+    {
+        const char* text = argValue(argc, argv, flag);
+        if (text && !parseRange(text, *range))
+        {
+            std::cout << "sweep: bad range for " << flag << ": " << text << " (want value or lo:hi:count)\n";
+            return 1;
+        }
+    }
+    if (!(spec.maxDt.lo > 0.0) || !(spec.maxDt.hi > 0.0))
+    {
+        std::cout << "sweep: --max-dt must be positive\n";
+        return 1;
+    }
+
+    const char* duration = argValue(argc, argv, "--duration");
+    spec.duration = duration ? std::strtod(duration, nullptr) : HEADLESS_DURATION;
+    spec.base = starterState(1.f);
+    spec.baseMu = G * EARTH_MASS;
+    spec.minDist = MIN_DIST;
+    spec.atmosphere = &earthAtmosphere();
+    spec.ballistic = DRAG_BALLISTIC;
+    spec.surfaceRadius = EARTH_RADIUS;
+    spec.escapeRadius = HEADLESS_ESCAPE_RADIUS;
+
+    double ms = 0.0;
+    unsigned threads = std::max(std::thread::hardware_concurrency(), 1u);
+    std::vector<SweepRow> rows = runSweep(spec, threads, &ms);
+
+    bool toStdout = std::string(table) == "-";
+    std::FILE* f = toStdout ? stdout : std::fopen(table, "w");
+    if (!f)
+    {
+        std::cout << "sweep: cannot write " << table << '\n';
+        return 1;
+    }
+    writeSweepTable(f, rows, !toStdout);
+    if (!toStdout) std::fclose(f);
+
+    size_t counts[3] = {};
+    for (const SweepRow& r : rows) ++counts[static_cast<int>(r.outcome)];
+    std::cout << "sweep: " << rows.size() << " combinations in " << ms << " ms (" << counts[0] << " bound, "
+              << counts[1] << " impact, " << counts[2] << " escape)" << (toStdout ? "" : " -> ") << (toStdout ? "" : table) << '\n';
+    return 0;
+}
+
+// Sim seconds in a headless year: KESSLER_REVS_PER_YEAR revolutions of the
+// reference orbit, so --lifetime and --kessler count years alike.
+static double headlessYear()
+{
+    const double mu = G * EARTH_MASS;
+    const double reference = EARTH_RADIUS * (1.0 + KESSLER_REFERENCE_ALTITUDE / EARTH_RADIUS_METERS);
+    return KESSLER_REVS_PER_YEAR * 2.0 * KEPLER_PI * std::sqrt(reference * reference * reference / mu);
+}
+
+// --lifetime <objects> [--seed k] [--duration s | --years y] [--min-alt h] [--max-alt h] [--j2 k] [--ballistic b]
+// The tangential drift is off unless --j2 is given, and drag is far weaker than
+// in the window: either at the interactive strength brings every orbit down
+// within a few revolutions, before orbit averaging has anything to do.
+static int runLifetimeCommand(int argc, char** argv, const char* objects)
+{
+    auto number = [&](const char* flag, double fallback)
+    {
+        const char* v = argValue(argc, argv, flag);
+        return v ? std::strtod(v, nullptr) : fallback;
+    };
+
+    LifetimeSpec spec;
+    spec.objects = std::strtoull(objects, nullptr, 10);
+    spec.seed = static_cast<uint64_t>(number("--seed", 1.0));
+    spec.year = headlessYear();
+    spec.duration = number("--years", LIFETIME_YEARS) * spec.year;
+    if (const char* seconds = argValue(argc, argv, "--duration")) spec.duration = std::strtod(seconds, nullptr);
+    spec.minRadius = EARTH_RADIUS + number("--min-alt", LIFETIME_MIN_ALTITUDE);
+    spec.maxRadius = EARTH_RADIUS + number("--max-alt", LIFETIME_MAX_ALTITUDE);
+    spec.maxEccentricity = LIFETIME_MAX_ECCENTRICITY;
+    spec.surfaceRadius = EARTH_RADIUS;
+    spec.escapeRadius = HEADLESS_ESCAPE_RADIUS;
+    if (spec.objects == 0 || !(spec.duration > 0.0) || !(spec.minRadius > EARTH_RADIUS) || spec.maxRadius < spec.minRadius)
+    {
+        std::cout << "lifetime: need a positive object count and duration, and 0 < min-alt <= max-alt\n";
+        return 1;
+    }
+
+    ForceModel force = earthForce();
+    force.j2 = static_cast<float>(number("--j2", 0.0));
+    force.ballistic = static_cast<float>(number("--ballistic", LIFETIME_BALLISTIC));
+
+    unsigned threads = std::max(std::thread::hardware_concurrency(), 1u);
+    LifetimeStats stats = runLifetime(spec, force, threads);
+    printLifetime(spec, stats);
+    return 0;
+}
+
+// --kessler <objects> [--out stats.csv | -] [--seed k] [--years y] [--step days] [--report days]
+//   [--min-alt h] [--max-alt h] [--cell c] [--j2 k]
+// The tangential drift is off unless --j2 is given: over years it would bring
+// every orbit down on its own.
+static int runKesslerCommand(int argc, char** argv, const char* objects)
+{
+    auto number = [&](const char* flag, double fallback)
+    {
+        const char* v = argValue(argc, argv, flag);
+        return v ? std::strtod(v, nullptr) : fallback;
+    };
+
+    const double day = headlessYear() / 365.25;
+
+    KesslerSpec spec;
+    spec.objects = std::strtoull(objects, nullptr, 10);
+    spec.seed = static_cast<uint64_t>(number("--seed", 1.0));
+    spec.year = 365.25 * day;
+    spec.years = number("--years", KESSLER_YEARS);
+    spec.step = number("--step", KESSLER_STEP_DAYS) * day;
+    spec.report = number("--report", KESSLER_REPORT_DAYS) * day;
+    spec.minRadius = EARTH_RADIUS + number("--min-alt", KESSLER_MIN_ALTITUDE);
+    spec.maxRadius = EARTH_RADIUS + number("--max-alt", KESSLER_MAX_ALTITUDE);
+    spec.maxEccentricity = KESSLER_MAX_ECCENTRICITY;
+    spec.surfaceRadius = EARTH_RADIUS;
+    spec.escapeRadius = HEADLESS_ESCAPE_RADIUS;
+    spec.binTop = 2.0 * (spec.maxRadius - EARTH_RADIUS);
+    spec.cell = number("--cell", KESSLER_CELL);
+    spec.metersPerUnit = EARTH_RADIUS_METERS / EARTH_RADIUS;
+    spec.mass = SATELLITE_MASS;
+    spec.radius = KESSLER_SATELLITE_RADIUS;
+    spec.areaToMass = KESSLER_SATELLITE_AREA_TO_MASS;
+    spec.ballisticScale = KESSLER_BALLISTIC_SCALE;
+    if (spec.objects == 0 || !(spec.years > 0.0) || !(spec.step > 0.0) || !(spec.report > 0.0) || !(spec.cell > 0.0)
+        || !(spec.minRadius > EARTH_RADIUS) || spec.maxRadius < spec.minRadius)
+    {
+        std::cout << "kessler: need positive objects, years, step, report and cell, and 0 < min-alt <= max-alt\n";
+        return 1;
+    }
+
+    const char* path = argValue(argc, argv, "--out");
+    if (!path) path = "kessler.csv";
+    bool toStdout = std::string(path) == "-";
+    std::FILE* out = toStdout ? stdout : std::fopen(path, "w");
+    if (!out)
+    {
+        std::cout << "kessler: cannot write " << path << '\n';
+        return 1;
+    }
+
+    ForceModel force = earthForce();
+    force.j2 = static_cast<float>(number("--j2", 0.0));
+
+    unsigned threads = std::max(std::thread::hardware_concurrency(), 1u);
+    KesslerStats stats = runKessler(spec, force, threads, out);
+    if (!toStdout)
+    {
+        std::fclose(out);
+        std::cout << "kessler: statistics -> " << path << '\n';
+    }
+    printKessler(spec, stats);
+    return 0;
+}
+
+// Steps an inclined shell under the zonal field and compares the node drift of
+// its first body with the secular J2 rate (meaningful over many revolutions).
+static int runZonalCommand(int argc, char** argv, const char* bodies)
+{
+    auto number = [&](const char* flag, double fallback)
+    {
+        const char* v = argValue(argc, argv, flag);
+        return v ? std::strtod(v, nullptr) : fallback;
+    };
+
+    size_t count = std::strtoull(bodies, nullptr, 10);
+    int degree = static_cast<int>(number("--degree", ZONAL_DEGREE));
+    double duration = number("--duration", ZONAL_DURATION);
+    double inclination = number("--inclination", ZONAL_SHELL_INCLINATION);
+    if (count == 0 || !(duration > 0.0))
+    {
+        std::cout << "zonal: need a positive body count and duration\n";
+        return 1;
+    }
+
+    const ZonalModel model = makeZonalModel(G * EARTH_MASS, EARTH_RADIUS, degree);
+    BodyBatch3 shell;
+    fillZonalShell(shell, count, inclination);
+    const Vec3d r0 = shell.position(0), v0 = shell.velocity(0);
+
+    const int steps = std::max(1, static_cast<int>(std::ceil(duration / MAX_DT)));
+    const float dt = static_cast<float>(duration / steps);
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < steps; ++i) stepZonal(model, shell, dt);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    // secular J2 node rate of a circular orbit: -3/2 n J2 (R / a)^2 cos i
+    double a = norm(r0), n = std::sqrt(model.mu / (a * a * a));
+    double theory = -1.5 * n * EARTH_ZONALS[2] * (EARTH_RADIUS / a) * (EARTH_RADIUS / a) * std::cos(inclination * KEPLER_PI / 180.0) * duration;
+    double drift = std::remainder(nodeOf(shell.position(0), shell.velocity(0)) - nodeOf(r0, v0), 2.0 * KEPLER_PI);
+
+    std::printf("zonal %zu bodies, J2..J%d, %d steps of %g: %.3f ms per step\n", count, model.degree, steps, dt, ms / steps);
+    std::printf("  body 0 node drift %.6g rad (J2 secular rate predicts %.6g)\n", drift, theory);
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    // headless runs exit before a window is opened
+    if (const char* members = argValue(argc, argv, "--ensemble"))
+        return runEnsembleCommand(argc, argv, members);
+    if (const char* table = argValue(argc, argv, "--sweep"))
+        return runSweepCommand(argc, argv, table);
+    if (const char* objects = argValue(argc, argv, "--lifetime"))
+        return runLifetimeCommand(argc, argv, objects);
+    if (const char* bodies = argValue(argc, argv, "--zonal"))
+        return runZonalCommand(argc, argv, bodies);
+    if (const char* objects = argValue(argc, argv, "--kessler"))
+        return runKesslerCommand(argc, argv, objects);
+
     sf::RenderWindow window(sf::VideoMode({ 1200,900 }), "INSANE Orbital Simulator");
     window.setFramerateLimit(60);
 
@@ -94,169 +1290,553 @@ int main()
     earth.setOrigin({ EARTH_RADIUS, EARTH_RADIUS });
     earth.setPosition({ 600.f,450.f });
 
+    // --config <file> overrides the tunables, and is re-read whenever it changes
+    ConfigWatcher config;
+    if (const char* path = argValue(argc, argv, "--config"))
+    {
+        config.path = path;
+        if (config.changed() && loadTunables(path, tunables) >= 0) std::cout << "config: loaded " << path << '\n';
+        else std::cout << "cannot read config " << path << " yet, watching it\n";
+    }
+
     std::vector<Satellite> sats;
     sats.reserve(16);
+    uint32_t nextSatelliteId = 0;
+    EphemerisCache ephemerides(earthForce(), EARTH_RADIUS);
 
     // starter satellite
     {
         Satellite s;
+        s.id = nextSatelliteId++;
         s.shape = sf::CircleShape(6.f);
         s.shape.setFillColor(sf::Color::Red);
         s.shape.setOrigin({ 6,6 });
-        s.shape.setPosition({ 350,0 });
         // apply speed scale to lengthen/shorten orbital period
-        s.velocity = { 0, std::sqrt(G * EARTH_MASS / 350.f) * ORBIT_SPEED_SCALE };
+        KeplerState start = starterState(tunables.orbitSpeedScale);
+        s.position = worldPoint(start.r);
+        s.velocity = { static_cast<float>(start.v.x), static_cast<float>(start.v.y) };
+        s.level = entryLevel(s, 0);
         s.trail.reserve(512);
+        s.reference = invariantsOf(s.position, s.velocity);
+        anchorCovariance(s);
         sats.push_back(std::move(s));
     }
 
     sf::Clock clock;
-    int energyCounter = 0;
+
+    TelemetryRing telemetryRing;
+    TelemetryReporter telemetryReporter(telemetryRing);
+    TelemetryBatch telemetryBatch;
+    size_t physicsStep = 0;
+    BlockClock blockClock;
+    BlockLevels blockLevels;
+    BodyBatch stepBatchScratch;
+    bool lazyMode = false;
+    PropagatorModes propagatorModes;
+    std::vector<OrbitEvent> frameEvents;
+    std::deque<OrbitEvent> eventLog;
+    ManeuverTimeline maneuvers;
+    std::vector<uint32_t> burnedIds;
+    PorkchopPlanner porkchopPlanner;
+    Porkchop porkchop;
+    sf::Texture porkchopTexture;
+    bool porkchopVisible = false;
+    std::vector<UncertaintyEllipse> uncertainty;
+    uint32_t uncertaintyId = 0;
+    bool uncertaintyStale = true;
+    bool uncertaintyVisible = true;
+    bool thirdBodiesOn = false;
+    BodyBatch3 zonalShell;
+    ShellView shellView = ShellView::Off;
+    std::vector<sf::Vertex> shellPoints;
+    Swarm swarm;
+    uint64_t swarmSeed = 1;
+    std::vector<sf::Vertex> swarmPoints;
+    bool collisionsOn = false;
+    uint32_t breakupEvents = 0;
+    CollisionGrid collisionGrid;
+    std::vector<std::pair<uint32_t, uint32_t>> collisionPairs;
+    TimeWarp warp;
+    QualityGovernor quality;
+    uint64_t trailSamples = 0;
+    sf::RenderTexture sceneTexture;       // the world at reduced resolution, when the governor asks for it
+    sceneTexture.setSmooth(true);
+    sf::CircleShape moon(MOON_RADIUS);
+    moon.setFillColor(sf::Color(170, 170, 170));
+    moon.setOrigin({ MOON_RADIUS, MOON_RADIUS });
+
+    // --maneuvers <file> queues a scripted burn campaign
+    for (int i = 1; i + 1 < argc; ++i)
+    {
+        if (std::string(argv[i]) != "--maneuvers") continue;
+        int queued = loadManeuvers(argv[i + 1], maneuvers);
+        if (queued < 0) std::cout << "cannot read maneuvers from " << argv[i + 1] << '\n';
+        else std::cout << "queued " << queued << " maneuvers from " << argv[i + 1] << '\n';
+    }
+
+    // --swarm shell:1000000,walker,debris:5000 spawns bulk populations up front
+    if (const char* list = argValue(argc, argv, "--swarm"))
+    {
+        std::string items = list;
+        for (size_t start = 0; start <= items.size();)
+        {
+            size_t end = std::min(items.find(',', start), items.size());
+            spawnSwarm(swarm, items.substr(start, end - start), sats, swarmSeed++, 0.f);
+            start = end + 1;
+        }
+        std::cout << "swarm: " << swarm.size() << " bodies\n";
+    }
+
+    // --warp <factor> starts the sim time-warped (1 to WARP_MAX)
+    if (const char* factor = argValue(argc, argv, "--warp"))
+        warp.set(std::strtod(factor, nullptr));
+
+    FrameProfiler profiler;
+    nameTraceThread("main");
+    sf::Font font;
+    bool hasFont = false;
+    for (const char* path : { "C:/Windows/Fonts/consola.ttf", "/usr/share/fonts/truetype/dejavu/DejaVuSansMono.ttf" })
+        if (!hasFont) hasFont = font.openFromFile(path);
 
     while (window.isOpen())
     {
-        // compute delta time and clamp for stability
+        TraceScope frameTrace("frame");
+
+        // config edits land between frames and invalidate only what they touch
+        if (!config.path.empty() && physicsStep % CONFIG_POLL_FRAMES == 0 && config.changed())
+        {
+            Tunables next = tunables;
+            int read = loadTunables(config.path.string(), next);
+            if (read >= 0)
+            {
+                uint32_t effects = applyTunables(next, sats, blockClock, ephemerides, thirdBodiesOn);
+                if (effects & TUNE_FORCE) uncertaintyStale = true;
+                std::cout << "config: reloaded " << read << " values from " << config.path.string() << '\n';
+            }
+        }
+
+        // compute delta time and clamp for stability; warped frames cut it into substeps
         float dt = clock.restart().asSeconds();
         if (dt <= 0.f) dt = 1.f / 60.f;
-        dt = std::min(dt, MAX_DT);
+        dt = std::min(dt, tunables.maxDt);
 
-        while (auto event = window.pollEvent())
         {
-            if (event->is<sf::Event::Closed>())
-                window.close();
+            ScopedPhase scope(profiler, FramePhase::Events);
 
-            // Zoom
-            if (auto wheel = event->getIf<sf::Event::MouseWheelScrolled>())
+            while (auto event = window.pollEvent())
             {
-                if (wheel->delta > 0) view.zoom(0.9f);
-                else view.zoom(1.1f);
-
-                // clamp zoom a little (prevent runaway)
-                float minSize = 50.f;
-                float maxSize = 5000.f;
-                sf::Vector2f size = view.getSize();
-                size.x = std::clamp(size.x, minSize, maxSize);
-                size.y = std::clamp(size.y, minSize * 0.75f, maxSize * 0.75f);
-                view.setSize(size);
-            }
+                if (event->is<sf::Event::Closed>())
+                    window.close();
 
-            // Click spawn satellite
-            if (auto click = event->getIf<sf::Event::MouseButtonPressed>())
-            {
-                if (click->button == sf::Mouse::Button::Left)
+                // F3 toggles the frame profiler overlay
+                if (auto key = event->getIf<sf::Event::KeyPressed>())
+                {
+                    if (key->code == sf::Keyboard::Key::F3)
+                        profiler.overlayVisible = !profiler.overlayVisible;
+
+                    // F4 captures a Chrome/Perfetto trace of the next few seconds
+                    if (key->code == sf::Keyboard::Key::F4)
+                        startTrace(TRACE_SECONDS);
+
+                    // L toggles lazy propagation of off-screen satellites
+                    if (key->code == sf::Keyboard::Key::L)
+                    {
+                        lazyMode = !lazyMode;
+                        std::cout << "lazy propagation " << (lazyMode ? "on" : "off") << '\n';
+                    }
+
+                    // R toggles the regularized propagator for eccentric orbits
+                    if (key->code == sf::Keyboard::Key::R)
+                    {
+                        propagatorModes.regularized = !propagatorModes.regularized;
+                        std::cout << "regularized propagation " << (propagatorModes.regularized ? "on" : "off") << '\n';
+                    }
+
+                    // Up/Down queue a prograde/retrograde kick on the first satellite
+                    if ((key->code == sf::Keyboard::Key::Up || key->code == sf::Keyboard::Key::Down) && !sats.empty())
+                    {
+                        Maneuver kick;
+                        kick.t = blockClock.simTime();
+                        kick.body = sats[0].id;
+                        kick.prograde = key->code == sf::Keyboard::Key::Up ? MANEUVER_NUDGE : -MANEUVER_NUDGE;
+                        maneuvers.schedule(kick);
+                    }
+
+                    // P plots transfers from the first to the second satellite, or hides the plot
+                    if (key->code == sf::Keyboard::Key::P)
+                    {
+                        if (porkchopVisible) porkchopVisible = false;
+                        else if (sats.size() < 2) std::cout << "porkchop needs two satellites\n";
+                        else if (porkchopPlanner.start(porkchopSpec(sats[0], sats[1], blockClock)))
+                            std::cout << "porkchop: satellite " << sats[0].id << " -> " << sats[1].id << '\n';
+                    }
+
+                    // U toggles the uncertainty ellipses along the ghost path
+                    if (key->code == sf::Keyboard::Key::U)
+                        uncertaintyVisible = !uncertaintyVisible;
+
+                    // M toggles the Moon and Sun tides
+                    if (key->code == sf::Keyboard::Key::M)
+                    {
+                        thirdBodiesOn = !thirdBodiesOn;
+                        refitEphemerides(ephemerides, thirdBodiesOn, sats);
+                        uncertaintyStale = true;
+                        std::cout << "third bodies " << (thirdBodiesOn ? "on" : "off") << '\n';
+                    }
+
+                    // I cycles the inclined shell: equatorial view, first shell orbit's plane, off
+                    if (key->code == sf::Keyboard::Key::I)
+                    {
+                        shellView = shellView == ShellView::Off ? ShellView::Equatorial
+                                  : shellView == ShellView::Equatorial ? ShellView::Orbital : ShellView::Off;
+                        if (shellView == ShellView::Equatorial && zonalShell.size() == 0)
+                            fillZonalShell(zonalShell, ZONAL_SHELL_SIZE, ZONAL_SHELL_INCLINATION);
+                        const char* names[] = { "off", "equatorial plane", "orbital plane" };
+                        std::cout << "zonal shell " << names[static_cast<int>(shellView)] << '\n';
+                    }
+
+                    // 1/2/3 add a Walker constellation, a random shell or a debris cloud; 0 clears them
+                    const char* generator = key->code == sf::Keyboard::Key::Num1 ? "walker"
+                                          : key->code == sf::Keyboard::Key::Num2 ? "shell"
+                                          : key->code == sf::Keyboard::Key::Num3 ? "debris" : nullptr;
+                    if (generator)
+                    {
+                        size_t added = spawnSwarm(swarm, generator, sats, swarmSeed++, static_cast<float>(blockClock.simTime()));
+                        std::cout << "swarm: +" << added << " " << generator << ", " << swarm.size() << " bodies\n";
+                    }
+                    if (key->code == sf::Keyboard::Key::Num0)
+                        swarm.clear();
+
+                    // C toggles collisions and breakups
+                    if (key->code == sf::Keyboard::Key::C)
+                    {
+                        collisionsOn = !collisionsOn;
+                        std::cout << "collisions " << (collisionsOn ? "on" : "off") << '\n';
+                    }
+
+                    // [ and ] step the time warp down and up the 1-2-5 ladder
+                    if (key->code == sf::Keyboard::Key::LBracket || key->code == sf::Keyboard::Key::RBracket)
+                    {
+                        warp.set(nextWarp(warp.factor, key->code == sf::Keyboard::Key::RBracket));
+                        std::cout << "time warp " << warp.factor << "x\n";
+                    }
+
+                    // Q switches the quality governor off (full detail) or back on
+                    if (key->code == sf::Keyboard::Key::Q)
+                    {
+                        quality.toggle();
+                        trailFraction = 1.f;
+                        std::cout << "quality governor " << (quality.enabled ? "on" : "off") << '\n';
+                    }
+
+                    // E toggles Encke propagation for weakly perturbed orbits
+                    if (key->code == sf::Keyboard::Key::E)
+                    {
+                        propagatorModes.encke = !propagatorModes.encke;
+                        std::cout << "Encke propagation " << (propagatorModes.encke ? "on" : "off") << '\n';
+                    }
+                }
+
+                // Zoom
+                if (auto wheel = event->getIf<sf::Event::MouseWheelScrolled>())
                 {
-                    sf::Vector2f worldPos =
-                        window.mapPixelToCoords(
-                            sf::Mouse::getPosition(window));
+                    if (wheel->delta > 0) view.zoom(0.9f);
+                    else view.zoom(1.1f);
+
+                    // clamp zoom a little (prevent runaway)
+                    float minSize = 50.f;
+                    float maxSize = 5000.f;
+                    sf::Vector2f size = view.getSize();
+                    size.x = std::clamp(size.x, minSize, maxSize);
+                    size.y = std::clamp(size.y, minSize * 0.75f, maxSize * 0.75f);
+                    view.setSize(size);
+                }
 
-                    float r = length(worldPos - EARTH_CENTER);
-                    if (r > EARTH_RADIUS + 5.f) // require spawn outside Earth's surface
+                // Click spawn satellite
+                if (auto click = event->getIf<sf::Event::MouseButtonPressed>())
+                {
+                    if (click->button == sf::Mouse::Button::Left)
                     {
-                        Satellite ns;
-                        ns.shape = sf::CircleShape(5.f);
-                        ns.shape.setFillColor(sf::Color::Yellow);
-                        ns.shape.setOrigin({ 5,5 });
-                        ns.shape.setPosition(worldPos);
+                        sf::Vector2f worldPos =
+                            window.mapPixelToCoords(
+                                sf::Mouse::getPosition(window));
 
-                        sf::Vector2f dir = normalize(worldPos - EARTH_CENTER);
-                        sf::Vector2f tangent = { -dir.y, dir.x };
+                        float r = length(worldPos - EARTH_CENTER);
+                        if (r > EARTH_RADIUS + 5.f) // require spawn outside Earth's surface
+                        {
+                            Satellite ns;
+                            ns.id = nextSatelliteId++;
+                            ns.shape = sf::CircleShape(5.f);
+                            ns.shape.setFillColor(sf::Color::Yellow);
+                            ns.shape.setOrigin({ 5,5 });
+                            ns.position = worldPos;
+                            ns.epoch = blockClock.blockTime();
 
-                        // apply speed scale to make spawned satellites orbit slower/faster
-                        float v = std::sqrt(G * EARTH_MASS / std::max(r, MIN_DIST)) * ORBIT_SPEED_SCALE;
-                        ns.velocity = tangent * v;
+                            sf::Vector2f dir = normalize(worldPos - EARTH_CENTER);
+                            sf::Vector2f tangent = { -dir.y, dir.x };
 
-                        ns.trail.reserve(256);
-                        sats.push_back(std::move(ns));
+                            // apply speed scale to make spawned satellites orbit slower/faster
+                            float v = std::sqrt(earthMu() / std::max(r, MIN_DIST)) * tunables.orbitSpeedScale;
+                            ns.velocity = tangent * v;
+                            ns.level = entryLevel(ns, blockClock.tick);
+
+                            ns.trail.reserve(256);
+                            ns.reference = invariantsOf(worldPos, ns.velocity);
+                            anchorCovariance(ns);
+                            sats.push_back(std::move(ns));
+                        }
                     }
                 }
             }
+
+            // Camera pan (scale pan by view zoom so movement feels consistent)
+            float camBase = 8.f;
+            sf::Vector2f viewSize = view.getSize();
+            float zoomScale = viewSize.x / 1200.f;
+            float cam = camBase * zoomScale;
+            if (sf::Keyboard::isKeyPressed(sf::Keyboard::Key::A)) view.move({ -cam,0 });
+            if (sf::Keyboard::isKeyPressed(sf::Keyboard::Key::D)) view.move({ cam,0 });
+            if (sf::Keyboard::isKeyPressed(sf::Keyboard::Key::W)) view.move({ 0,-cam });
+            if (sf::Keyboard::isKeyPressed(sf::Keyboard::Key::S)) view.move({ 0,cam });
         }
 
-        // Camera pan (scale pan by view zoom so movement feels consistent)
-        float camBase = 8.f;
-        sf::Vector2f viewSize = view.getSize();
-        float zoomScale = viewSize.x / 1200.f;
-        float cam = camBase * zoomScale;
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Key::A)) view.move({ -cam,0 });
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Key::D)) view.move({ cam,0 });
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Key::W)) view.move({ 0,-cam });
-        if (sf::Keyboard::isKeyPressed(sf::Keyboard::Key::S)) view.move({ 0,cam });
-
-        // Physics update (iterate backwards to allow safe removal)
-        for (int i = static_cast<int>(sats.size()) - 1; i >= 0; --i)
         {
-            Satellite& sat = sats[i];
-            if (!sat.alive) { sats.erase(sats.begin() + i); continue; }
-
-            sf::Vector2f pos = sat.shape.getPosition();
-            sf::Vector2f toEarth = EARTH_CENTER - pos;
+            ScopedPhase scope(profiler, FramePhase::Physics);
 
-
-            float dist = length(toEarth);
-            if (dist <= EARTH_RADIUS)
+            // Retire dead bodies and catch up any frozen body that is observed again
+            // (iterate backwards to allow safe removal)
+            for (int i = static_cast<int>(sats.size()) - 1; i >= 0; --i)
             {
-                // simple collision: mark dead (could add explosion, scoring, etc.)
-                sat.alive = false;
-                continue;
+                Satellite& sat = sats[i];
+                if (!sat.alive)
+                {
+                    ephemerides.forget(sat.id);
+                    sats.erase(sats.begin() + i);
+                    continue;
+                }
+
+                // sats[0] feeds the ghost path, so it is always observed
+                if (sat.lazy && (!lazyMode || i == 0 || orbitTouchesView(sat.lazyPeri, sat.lazyApo, view)))
+                    rejoinGrid(sat, blockClock);
             }
 
-            sf::Vector2f dir = normalize(toEarth);
+            frameEvents.clear();
+            sortIntoLevels(sats, blockLevels);
+            const ThirdBodies* thirdBodies = thirdBodiesOn ? &earthThirdBodies() : nullptr;
 
-            float accel = G * EARTH_MASS / (dist * dist + MIN_DIST);
-            sf::Vector2f a = dir * accel;
+            // the frame's warped sim time, substep by substep until the budget is spent
+            warp.begin(dt, tunables.maxDt, profiler.lastFrameExcept({ FramePhase::Physics, FramePhase::Present }));
+            do
+            {
+                blockClock.pending += warp.h;
+                advanceBlocks(sats, blockLevels, blockClock, stepBatchScratch, thirdBodies, maneuvers, burnedIds, frameEvents);
 
-            // Fake J2 drift
-            sf::Vector2f tangent = { -dir.y, dir.x };
-            a += tangent * J2_STRENGTH * dist;
+                // the off-grid propagators and the swarm share one sample per substep
+                const ThirdBodyField frameBodies = thirdBodies ? thirdBodies->at(blockClock.blockTime()) : ThirdBodyField();
+                advanceRegularized(sats, blockClock, frameBodies, frameEvents);
+                advanceEncke(sats, blockClock, frameBodies, frameEvents);
+                if (shellView != ShellView::Off) stepZonal(earthZonals(), zonalShell, warp.h);
+                if (swarm.size() != 0)
+                {
+                    ForceModel swarmForce = earthForce();
+                    swarmForce.bodies = frameBodies;
+                    swarm.step(swarmForce, warp.h);
+                }
+                if (collisionsOn)
+                {
+                    const size_t before = swarm.size();
+                    size_t collisions = collideBodies(swarm, sats, blockClock.simTime(), swarmSeed, breakupEvents, collisionGrid, collisionPairs);
+                    if (collisions)
+                        std::cout << "collisions: " << collisions << ", +" << swarm.size() - before << " fragments\n";
+                    // top the pool back up here, so the next cascade does not allocate mid-breakup
+                    swarm.reserve(FRAGMENT_RESERVE);
+                }
+                if (swarm.size() != 0) swarm.cull(EARTH_CENTER, EARTH_RADIUS);
 
-            // integrate with dt
-            sat.velocity += a * dt;
-            pos += sat.velocity * dt;
+                if (warp.trailDue() && ++trailSamples % quality.knobs().trailStride == 0)
+                {
+                    for (Satellite& sat : sats)
+                    {
+                        if (!sat.moved) continue;
+                        appendTrail(sat, sat.position);
+                        sat.moved = false;
+                    }
+                }
+            } while (warp.next());
 
-            sat.shape.setPosition(pos);
+            if (warp.end(dt))
+            {
+                if (warp.behind)
+                    std::cout << "time warp " << warp.factor << "x does not fit the frame, running at " << std::lround(warp.achieved) << "x\n";
+                else
+                    std::cout << "time warp " << warp.factor << "x sustained again\n";
+            }
+            logEvents(frameEvents, eventLog);
 
-            // Trail: append, and remove excess in larger blocks to avoid O(n^2)
-            sat.trail.emplace_back(pos, sf::Color::Green);
-            if (sat.trail.size() > MAX_TRAIL)
+            // only burned bodies lose their predictions; their covariance restarts from the new state
+            for (uint32_t id : burnedIds)
             {
-                // remove oldest block to amortize cost
-                size_t removeCount = sat.trail.size() - MAX_TRAIL;
-                if (removeCount < 16) removeCount = 16;
-                sat.trail.erase(sat.trail.begin(), sat.trail.begin() + static_cast<long>(removeCount));
+                ephemerides.invalidate(id);
+                if (Satellite* sat = findSatellite(sats, id)) anchorCovariance(*sat);
+                if (!sats.empty() && id == sats[0].id) uncertaintyStale = true;
             }
+            burnedIds.clear();
 
-            // Energy print debug: once per 200 physics updates (global)
-            ++energyCounter;
-            if (energyCounter % 200 == 0)
+            for (size_t i = 0; i < sats.size(); ++i)
             {
-                std::cout << "Energy: " << energy(pos, sat.velocity) << std::endl;
+                Satellite& sat = sats[i];
+                if (!sat.alive || sat.lazy) continue;
+
+                // the ghost-path body keeps its ephemeris topped up every frame
+                if (i == 0) ephemerides.refresh(sat.id, keplerStateOf(sat), sat.epoch);
+
+                // staggered so only a slice of the population is checked each frame
+                if ((physicsStep + i) % BODY_CHECK_INTERVAL != 0) continue;
+
+                ephemerides.refresh(sat.id, keplerStateOf(sat), sat.epoch);
+                advanceCovariance(sat, thirdBodies);
+                if (i == 0) uncertaintyStale = true;
+
+                // the ephemeris ends at surface contact, which makes it the re-entry forecast
+                auto forecast = ephemerides.find(sat.id);
+                if (forecast && forecast->impact && std::abs(forecast->end() - sat.reentryForecast) > REENTRY_REPORT_SHIFT)
+                {
+                    sat.reentryForecast = forecast->end();
+                    std::cout << "satellite " << sat.id << " re-entry predicted at t=" << sat.reentryForecast << '\n';
+                }
+
+                choosePropagator(sat, propagatorModes, blockClock);
+                if (lazyMode && i != 0)
+                    tryFreeze(sat, view);
             }
         }
 
-        window.clear(sf::Color::Black);
-        window.setView(view);
+        // Conserved-quantity drift for every body, off the per-body loop
+        if (++physicsStep % TELEMETRY_INTERVAL == 0)
+        {
+            ScopedPhase scope(profiler, FramePhase::Telemetry);
+            publishTelemetry(sats, telemetryBatch, telemetryRing, physicsStep);
+            telemetryReporter.flush(std::cout);
+        }
 
-        window.draw(earth);
+        if (porkchopPlanner.poll())
+        {
+            porkchop = porkchopPlanner.result;
+            if (porkchopTexture.resize({ porkchop.size, porkchop.size }))
+            {
+                porkchopTexture.update(porkchopPlanner.pixels.data());
+                porkchopVisible = true;
+            }
+            std::cout << "porkchop: " << porkchop.size << "x" << porkchop.size << " in " << porkchop.milliseconds
+                      << " ms, best dv " << porkchop.best << '\n';
+        }
 
-        // Draw predicted path for the first satellite (if any)
+        // Predicted path for the first satellite (if any)
+        std::vector<sf::Vertex> ghost;
         if (!sats.empty())
         {
-            auto ghost = predictOrbit(sats[0].shape.getPosition(), sats[0].velocity, 0.02f, 400);
-            if (!ghost.empty())
-                window.draw(&ghost[0], ghost.size(), sf::PrimitiveType::LineStrip);
+            ScopedPhase scope(profiler, FramePhase::Predict);
+            const ThirdBodies* thirdBodies = thirdBodiesOn ? &earthThirdBodies() : nullptr;
+            auto cached = ephemerides.find(sats[0].id);
+            double now = sats[0].epoch;
+            const int coarse = quality.knobs().predictDivisor;   // same span, fewer samples
+            if (cached && cached->covers(now))
+                ghost = ghostFromEphemeris(*cached, now, 0.02f * coarse, 400 / coarse);
+            else
+                ghost = predictOrbit(sats[0].position, sats[0].velocity, now, thirdBodies, 0.02f * coarse, 400 / coarse);
+
+            // ellipses are timestamped, so they only need redoing on the staggered check or a burn
+            if (uncertaintyVisible && (uncertaintyStale || uncertaintyId != sats[0].id))
+            {
+                uncertainty = predictUncertainty(sats[0], thirdBodies);
+                uncertaintyId = sats[0].id;
+                uncertaintyStale = false;
+            }
         }
 
-        // Draw satellites + trails
-        for (auto& sat : sats)
         {
-            if (!sat.trail.empty())
-                window.draw(&sat.trail[0], sat.trail.size(), sf::PrimitiveType::LineStrip);
+            ScopedPhase scope(profiler, FramePhase::Draw);
+
+            window.clear(sf::Color::Black);
+            window.setView(view);
+
+            // the world goes to a smaller texture when the governor lowers the
+            // resolution, and is scaled up under the full-resolution overlays
+            const float renderScale = quality.knobs().renderScale;
+            sf::RenderTarget* scene = &window;
+            if (renderScale < 1.f)
+            {
+                const sf::Vector2u size = { static_cast<unsigned>(static_cast<float>(window.getSize().x) * renderScale),
+                                            static_cast<unsigned>(static_cast<float>(window.getSize().y) * renderScale) };
+                if (sceneTexture.getSize() == size || sceneTexture.resize(size))
+                {
+                    scene = &sceneTexture;
+                    scene->clear(sf::Color::Black);
+                    scene->setView(view);
+                }
+            }
+
+            scene->draw(earth);
+            if (thirdBodiesOn)
+            {
+                Vec2d m = earthThirdBodies().tables[0].at(blockClock.simTime());
+                moon.setPosition(EARTH_CENTER + sf::Vector2f(static_cast<float>(m.x), static_cast<float>(m.y)));
+                scene->draw(moon);
+            }
+
+            if (!ghost.empty())
+                scene->draw(&ghost[0], ghost.size(), sf::PrimitiveType::LineStrip);
+
+            drawSwarm(*scene, swarm, swarmPoints);
+            drawZonalShell(*scene, zonalShell, shellView, shellPoints);
+
+            const double simTime = blockClock.simTime();
+            drawEventMarkers(*scene, eventLog, simTime);
+            if (uncertaintyVisible && !sats.empty())
+                drawUncertainty(*scene, uncertainty, simTime, quality.knobs().markerSegments);
 
-            window.draw(sat.shape);
+            // Draw satellites + trails; coarse-level bodies are extrapolated to the frame time
+            for (auto& sat : sats)
+            {
+                if (!sat.trail.empty())
+                    scene->draw(&sat.trail[0], sat.trail.size(), sf::PrimitiveType::LineStrip);
+
+                float ahead = sat.lazy ? 0.f : static_cast<float>(simTime - sat.epoch);
+                sat.shape.setPosition(sat.position + sat.velocity * ahead);
+                scene->draw(sat.shape);
+            }
+
+            if (scene == &sceneTexture)
+            {
+                sceneTexture.display();
+                sf::Sprite sprite(sceneTexture.getTexture());
+                sprite.setScale({ 1.f / renderScale, 1.f / renderScale });
+                window.setView(window.getDefaultView());
+                window.draw(sprite);
+                window.setView(view);   // clicks are mapped through the window's view
+            }
+
+            if (porkchopVisible)
+                drawPorkchopOverlay(window, porkchopTexture, porkchop, hasFont ? &font : nullptr);
+            drawProfilerOverlay(window, profiler, hasFont ? &font : nullptr);
         }
 
-        window.display();
+        {
+            ScopedPhase scope(profiler, FramePhase::Present);
+            window.display();
+        }
+
+        profiler.endFrame();
+        pollTrace();
+
+        // physics counts at one substep; the warp's own shortfall is pressure
+        float work = profiler.lastFrameExcept({ FramePhase::Physics, FramePhase::Present }) + warp.firstMs;
+        if (quality.update(work, warp.behind))
+        {
+            trailFraction = quality.knobs().trailFraction;
+            std::cout << "quality level " << quality.level << " (frame work " << std::lround(quality.smoothedMs) << " ms)\n";
+        }
     }
 
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include "Trace.h"
+
+// Worker pool for the headless runners. [0, count) is handed out in chunks
+// from a shared counter, so fast workers take more of the work; the calling
+// thread is one of the workers. body(first, last, worker) gets each chunk and
+// the index of the worker running it, which callers use to keep per-worker
+// state without locks. Returns once every chunk is done.
+
+// Workers a pool of `threads` runs, counting the caller.
+inline unsigned parallelWorkers(unsigned threads)
+{
+    return std::max(threads, 1u);
+}
+
+template <typename Body>
+void parallelFor(size_t count, size_t chunk, unsigned threads, const char* name, Body&& body)
+{
+    std::atomic<size_t> next{ 0 };
+    chunk = std::max<size_t>(chunk, 1);
+
+    auto worker = [&](unsigned index)
+    {
+        TraceScope trace(name);
+        for (size_t first = next.fetch_add(chunk); first < count; first = next.fetch_add(chunk))
+            body(first, std::min(first + chunk, count), index);
+    };
+
+    std::vector<std::jthread> pool;
+    for (unsigned w = 1; w < parallelWorkers(threads); ++w) pool.emplace_back(worker, w);
+    worker(0);
+}
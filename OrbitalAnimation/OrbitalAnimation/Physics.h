@@ -0,0 +1,279 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+
+#include "Atmosphere.h"
+#include "Kepler.h"
+#include "Simd.h"
+#include "ThirdBody.h"
+
+// Central gravity plus the small tangential "J2" drift used everywhere in the sim,
+// drag inside the atmosphere when one is attached, and the tides of any third
+// bodies sampled into the field for the current step.
+struct ForceModel
+{
+    sf::Vector2f center;
+    float mu = 0.f;           // G * M
+    float j2 = 0.f;
+    float minDist = 1e-3f;
+    const DensityTable* atmosphere = nullptr;
+    float ballistic = 0.f;    // Cd * A / m; drag is -ballistic * rho * |v| * v
+    ThirdBodyField bodies;
+};
+
+// Structure-of-arrays scratch for bodies that are stepped together.
+struct BodyBatch
+{
+    std::vector<float> px, py, vx, vy;
+
+    void clear() { px.clear(); py.clear(); vx.clear(); vy.clear(); }
+
+    void push(sf::Vector2f p, sf::Vector2f v)
+    {
+        px.push_back(p.x); py.push_back(p.y);
+        vx.push_back(v.x); vy.push_back(v.y);
+    }
+
+    size_t size() const { return px.size(); }
+
+    // pad with copies of the last body so every lane group is full
+    void pad()
+    {
+        if (px.empty()) return;
+        size_t padded = (px.size() + 3) & ~size_t(3);
+        for (std::vector<float>* a : { &px, &py, &vx, &vy }) a->resize(padded, a->back());
+    }
+};
+
+// Force terms. Each is a policy type with a scalar double-precision form,
+// at(f, x, v) with x relative to the center, and a lane form that is built
+// from the ForceModel once per batch (splatting its constants) and adds its
+// share to four bodies at a time. ForceSum<Terms...> folds them into one
+// kernel at compile time, so a model pays only for the terms it lists.
+
+// Positions relative to the center and the radius, shared by every term.
+struct ForceLanes
+{
+    f32x4 x, y, vx, vy;
+    f32x4 r2, dist;
+};
+
+// mu / (r^2 + minDist) toward the center
+struct CentralGravity
+{
+    f32x4 mu, minDist;
+
+    explicit CentralGravity(const ForceModel& f) : mu(f.mu), minDist(f.minDist) {}
+
+    static Vec2d at(const ForceModel& f, Vec2d x, Vec2d)
+    {
+        double r2 = dot(x, x);
+        double r = std::sqrt(r2);
+        double k = r > f.minDist ? f.mu / (r2 + f.minDist) / r : 0.0;
+        return x * -k;
+    }
+
+    void add(const ForceLanes& l, f32x4& ax, f32x4& ay) const
+    {
+        f32x4 k = select(l.dist > minDist, mu / (l.r2 + minDist) / l.dist, f32x4(0.f));   // normalize() returns zero at the center
+        ax -= l.x * k;
+        ay -= l.y * k;
+    }
+};
+
+// j2 * r along the prograde tangent
+struct TangentialDrift
+{
+    f32x4 j2;
+
+    explicit TangentialDrift(const ForceModel& f) : j2(f.j2) {}
+
+    static Vec2d at(const ForceModel& f, Vec2d x, Vec2d) { return Vec2d(x.y, -x.x) * static_cast<double>(f.j2); }
+
+    void add(const ForceLanes& l, f32x4& ax, f32x4& ay) const
+    {
+        ax += l.y * j2;
+        ay -= l.x * j2;
+    }
+};
+
+// -ballistic * rho * |v| * v below the ceiling (the atmosphere does not rotate).
+// Needs f.atmosphere; lane groups entirely above the ceiling skip the lookup.
+struct AtmosphericDrag
+{
+    const DensityTable* table;
+    f32x4 surface, ceiling, ballistic;
+
+    explicit AtmosphericDrag(const ForceModel& f)
+        : table(f.atmosphere), surface(f.atmosphere->surface), ceiling(f.atmosphere->ceiling), ballistic(f.ballistic) {}
+
+    static Vec2d at(const ForceModel& f, Vec2d x, Vec2d v)
+    {
+        float rho = f.atmosphere->at(static_cast<float>(norm(x)) - f.atmosphere->surface);
+        return v * (-static_cast<double>(f.ballistic) * rho * norm(v));
+    }
+
+    void add(const ForceLanes& l, f32x4& ax, f32x4& ay) const
+    {
+        f32x4 altitude = l.dist - surface;
+        if (!any(altitude < ceiling)) return;
+        f32x4 c = ballistic * table->at(altitude) * sqrt(l.vx * l.vx + l.vy * l.vy);
+        ax -= c * l.vx;
+        ay -= c * l.vy;
+    }
+};
+
+// Tides of the third bodies in f.bodies, positions splatted once per batch.
+struct ThirdBodyTides
+{
+    int count;
+    f32x4 bx[THIRD_BODY_MAX], by[THIRD_BODY_MAX], mu[THIRD_BODY_MAX];
+    f32x4 indirectX, indirectY;
+
+    explicit ThirdBodyTides(const ForceModel& f)
+        : count(f.bodies.count), indirectX(f.bodies.ax), indirectY(f.bodies.ay)
+    {
+        for (int k = 0; k < count; ++k)
+        {
+            bx[k] = f32x4(f.bodies.x[k]);
+            by[k] = f32x4(f.bodies.y[k]);
+            mu[k] = f32x4(f.bodies.mu[k]);
+        }
+    }
+
+    static Vec2d at(const ForceModel& f, Vec2d x, Vec2d) { return thirdBodyAcceleration(f.bodies, x); }
+
+    void add(const ForceLanes& l, f32x4& ax, f32x4& ay) const
+    {
+        ax -= indirectX;
+        ay -= indirectY;
+        for (int b = 0; b < count; ++b)
+        {
+            f32x4 sx = bx[b] - l.x, sy = by[b] - l.y;
+            f32x4 s2 = sx * sx + sy * sy;
+            f32x4 k = mu[b] / (s2 * sqrt(s2));
+            ax += sx * k;
+            ay += sy * k;
+        }
+    }
+};
+
+template <typename... Terms>
+struct ForceSum
+{
+    static Vec2d at(const ForceModel& f, Vec2d x, Vec2d v)
+    {
+        return (Terms::at(f, x, v) + ...);
+    }
+
+    // One semi-implicit Euler step of every body in the batch, four lanes at a time.
+    static void step(const ForceModel& f, BodyBatch& b, float dt)
+    {
+        const size_t n = b.size();
+        b.pad();
+
+        const std::tuple<Terms...> terms{ Terms(f)... };
+        const f32x4 cx(f.center.x), cy(f.center.y), vdt(dt);
+        for (size_t i = 0; i < b.size(); i += 4)
+        {
+            ForceLanes l;
+            l.x = f32x4::load(&b.px[i]) - cx;
+            l.y = f32x4::load(&b.py[i]) - cy;
+            l.vx = f32x4::load(&b.vx[i]);
+            l.vy = f32x4::load(&b.vy[i]);
+            l.r2 = l.x * l.x + l.y * l.y;
+            l.dist = sqrt(l.r2);
+
+            f32x4 ax, ay;
+            std::apply([&](const Terms&... t) { (t.add(l, ax, ay), ...); }, terms);
+
+            l.vx += ax * vdt;
+            l.vy += ay * vdt;
+            (l.x + cx + l.vx * vdt).store(&b.px[i]);
+            (l.y + cy + l.vy * vdt).store(&b.py[i]);
+            l.vx.store(&b.vx[i]);
+            l.vy.store(&b.vy[i]);
+        }
+
+        for (std::vector<float>* a : { &b.px, &b.py, &b.vx, &b.vy }) a->resize(n);
+    }
+};
+
+using ConservativeForce = ForceSum<CentralGravity, TangentialDrift>;
+
+inline bool hasDrag(const ForceModel& f) { return f.atmosphere && f.ballistic != 0.f; }
+
+// Scalar force without drag, x relative to the center.
+inline Vec2d accelerationAt(const ForceModel& f, Vec2d x)
+{
+    return f.bodies.count ? ForceSum<CentralGravity, TangentialDrift, ThirdBodyTides>::at(f, x, Vec2d())
+                          : ConservativeForce::at(f, x, Vec2d());
+}
+
+// Full force including drag, for integrators that carry the velocity.
+inline Vec2d accelerationAt(const ForceModel& f, Vec2d x, Vec2d v)
+{
+    return hasDrag(f) ? accelerationAt(f, x) + AtmosphericDrag::at(f, x, v) : accelerationAt(f, x);
+}
+
+// Step the batch with the kernel fused from exactly the terms the model has
+// switched on; the choice is made once per call, never per body.
+inline void stepBatch(const ForceModel& f, BodyBatch& b, float dt)
+{
+    const bool drag = hasDrag(f), tides = f.bodies.count > 0;
+    if (drag && tides) ForceSum<CentralGravity, TangentialDrift, AtmosphericDrag, ThirdBodyTides>::step(f, b, dt);
+    else if (drag) ForceSum<CentralGravity, TangentialDrift, AtmosphericDrag>::step(f, b, dt);
+    else if (tides) ForceSum<CentralGravity, TangentialDrift, ThirdBodyTides>::step(f, b, dt);
+    else ConservativeForce::step(f, b, dt);
+}
+
+// Hierarchical (block) timesteps. Level k steps with BLOCK_MAX_DT / 2^k and
+// all levels share one grid of ticks of the finest step, so a body at level k
+// steps every 2^(BLOCK_LEVELS-1-k) ticks and coarse bodies do proportionally
+// less work.
+const int BLOCK_LEVELS = 9;
+const float BLOCK_MAX_DT = 1.f;            // level 0 step
+// step <= BLOCK_ETA * dynamical time. Matches the worst energy error of the
+// old fixed 60 Hz step for bodies launched at ORBIT_SPEED_SCALE, where r / v
+// sets the time scale: those step at 64 Hz near the surface and 4 Hz at r = 600.
+const float BLOCK_ETA = 2.2e-3f;
+
+inline float blockDt(int level) { return BLOCK_MAX_DT / static_cast<float>(1u << level); }
+inline double tickDt() { return blockDt(BLOCK_LEVELS - 1); }
+
+inline uint64_t ticksPerStep(int level) { return uint64_t(1) << (BLOCK_LEVELS - 1 - level); }
+inline bool levelDue(int level, uint64_t tick) { return tick % ticksPerStep(level) == 0; }
+
+// Level whose step resolves the body's local dynamical time, min(sqrt(r^3/mu), r/v).
+inline int accuracyLevel(float dist, float speed, float mu)
+{
+    float tdyn = std::sqrt(dist * dist * dist / mu);
+    if (speed > 0.f) tdyn = std::min(tdyn, dist / speed);
+    float ratio = BLOCK_MAX_DT / std::max(BLOCK_ETA * tdyn, 1e-9f);
+    int level = ratio <= 1.f ? 0 : static_cast<int>(std::ceil(std::log2(ratio)));
+    return std::clamp(level, 0, BLOCK_LEVELS - 1);
+}
+
+// Coarsest level whose step grid contains this tick; a body may only join a
+// level at or finer than this without breaking synchronisation.
+inline int alignedLevel(uint64_t tick)
+{
+    for (int level = 0; level < BLOCK_LEVELS - 1; ++level)
+        if (levelDue(level, tick)) return level;
+    return BLOCK_LEVELS - 1;
+}
+
+// Sim time kept as whole ticks plus the not yet stepped remainder.
+struct BlockClock
+{
+    uint64_t tick = 0;
+    double pending = 0.0;
+
+    double blockTime() const { return static_cast<double>(tick) * tickDt(); }
+    double simTime() const { return blockTime() + pending; }
+};
@@ -0,0 +1,245 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <thread>
+#include <vector>
+
+#include "Kepler.h"
+#include "Lambert.h"
+#include "Parallel.h"
+#include "Trace.h"
+
+// Porkchop plot: total rendezvous delta-v over a grid of departure x arrival
+// times, one Lambert solve per cell. Rows are shared out across threads by
+// parallelFor (traced as "porkchop rows") and each row is one SoA Lambert batch.
+
+const unsigned PORKCHOP_SIZE = 1000;       // cells per axis
+const float PORKCHOP_DV_RANGE = 4.f;       // colour scale spans best .. best * this
+const float PORKCHOP_PANEL = 360.f;        // on-screen size of the overlay
+
+struct PorkchopSpec
+{
+    KeplerState from, to;         // both at epoch, relative to the central body
+    double epoch = 0.0;
+    double departSpan = 1.0;      // departures in [epoch, epoch + departSpan]
+    double arriveMin = 0.0;       // arrivals in [arriveMin, arriveMax], absolute
+    double arriveMax = 1.0;
+    double mu = 1.0;
+    double minPeriapsis = 0.0;    // transfers passing below this are rejected
+};
+
+struct Porkchop
+{
+    PorkchopSpec spec;
+    unsigned size = 0;
+    std::vector<float> dv;        // row = arrival, column = departure; NaN where no transfer
+    float best = std::numeric_limits<float>::infinity();
+    unsigned bestDepart = 0, bestArrive = 0;
+    double milliseconds = 0.0;
+
+    double departTime(unsigned i) const { return spec.epoch + spec.departSpan * i / (size - 1); }
+    double arriveTime(unsigned j) const { return spec.arriveMin + (spec.arriveMax - spec.arriveMin) * j / (size - 1); }
+};
+
+inline Porkchop computePorkchop(const PorkchopSpec& spec, unsigned size, unsigned threads)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    // Lambert solves counter-clockwise transfers; mirror a clockwise departure orbit
+    PorkchopSpec s = spec;
+    if (cross(s.from.r, s.from.v) < 0.0)
+    {
+        for (KeplerState* k : { &s.from, &s.to })
+        {
+            k->r.y = -k->r.y;
+            k->v.y = -k->v.y;
+        }
+    }
+
+    Porkchop p;
+    p.spec = spec;
+    p.size = size;
+    p.dv.assign(static_cast<size_t>(size) * size, std::numeric_limits<float>::quiet_NaN());
+
+    // endpoint states along both axes, analytically
+    std::vector<KeplerState> depart(size), arrive(size);
+    for (unsigned i = 0; i < size; ++i)
+    {
+        depart[i] = keplerPropagate(s.from, p.departTime(i) - s.epoch, s.mu);
+        arrive[i] = keplerPropagate(s.to, p.arriveTime(i) - s.epoch, s.mu);
+    }
+
+    std::vector<LambertBatch> batches(parallelWorkers(threads));
+    parallelFor(size, 1, threads, "porkchop rows", [&](size_t first, size_t last, unsigned worker)
+    {
+        LambertBatch& batch = batches[worker];
+        for (unsigned j = static_cast<unsigned>(first); j < last; ++j)
+        {
+            const KeplerState& b = arrive[j];
+            const double ta = p.arriveTime(j);
+
+            batch.clear();
+            for (unsigned i = 0; i < size; ++i)
+            {
+                const KeplerState& a = depart[i];
+                double tof = ta - p.departTime(i);
+                batch.push(static_cast<float>(a.r.x), static_cast<float>(a.r.y),
+                    static_cast<float>(b.r.x), static_cast<float>(b.r.y), static_cast<float>(std::max(tof, 1e-3)));
+            }
+            batch.solve(static_cast<float>(s.mu));
+
+            float* out = &p.dv[static_cast<size_t>(j) * size];
+            for (unsigned i = 0; i < size; ++i)
+            {
+                if (ta - p.departTime(i) <= 1e-3) continue;
+
+                KeplerState transfer = { depart[i].r, Vec2d(batch.v1x[i], batch.v1y[i]) };
+                Vec2d v2(batch.v2x[i], batch.v2y[i]);
+                if (!std::isfinite(transfer.v.x) || !std::isfinite(v2.x)) continue;
+
+                // periapsis lies on the arc only if the transfer falls inward then climbs out
+                if (dot(transfer.r, transfer.v) < 0.0 && dot(b.r, v2) > 0.0
+                    && conicBounds(transfer, s.mu).periapsis < s.minPeriapsis) continue;
+
+                out[i] = static_cast<float>(norm(transfer.v - depart[i].v) + norm(b.v - v2));
+            }
+        }
+    });
+
+    for (unsigned j = 0; j < size; ++j)
+    {
+        for (unsigned i = 0; i < size; ++i)
+        {
+            float v = p.dv[static_cast<size_t>(j) * size + i];
+            if (v < p.best)
+            {
+                p.best = v;
+                p.bestDepart = i;
+                p.bestArrive = j;
+            }
+        }
+    }
+
+    p.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return p;
+}
+
+// RGBA pixels, departure left to right and arrival bottom to top; log scale
+// from blue (best) through green and yellow to red, cells without a transfer clear.
+inline std::vector<std::uint8_t> porkchopPixels(const Porkchop& p)
+{
+    std::vector<std::uint8_t> pixels(static_cast<size_t>(p.size) * p.size * 4, 0);
+    const float span = std::log(PORKCHOP_DV_RANGE);
+    for (unsigned j = 0; j < p.size; ++j)
+    {
+        for (unsigned i = 0; i < p.size; ++i)
+        {
+            float v = p.dv[static_cast<size_t>(j) * p.size + i];
+            if (!(v > 0.f)) continue;
+
+            float u = std::clamp(std::log(v / p.best) / span, 0.f, 1.f);
+            float r = std::clamp(3.f * u - 1.f, 0.f, 1.f);
+            float g = std::clamp(u < 0.66f ? 3.f * u : 3.f - 3.f * u, 0.f, 1.f);
+            float b = std::clamp(1.f - 3.f * u, 0.f, 1.f);
+
+            std::uint8_t* px = &pixels[(static_cast<size_t>(p.size - 1 - j) * p.size + i) * 4];
+            px[0] = static_cast<std::uint8_t>(255.f * r);
+            px[1] = static_cast<std::uint8_t>(255.f * g);
+            px[2] = static_cast<std::uint8_t>(255.f * b);
+            px[3] = 220;
+        }
+    }
+    return pixels;
+}
+
+// Runs one grid at a time off the main thread; the main thread polls for the
+// finished plot and uploads it as a texture.
+struct PorkchopPlanner
+{
+    Porkchop result;
+    std::vector<std::uint8_t> pixels;
+    std::atomic<bool> ready{ false };
+    std::atomic<bool> busy{ false };
+    std::jthread worker;
+
+    // false if a plot is still being computed
+    bool start(const PorkchopSpec& spec)
+    {
+        if (busy.exchange(true)) return false;
+        if (worker.joinable()) worker.join();
+        ready = false;
+        worker = std::jthread([this, spec]
+        {
+            TraceScope trace("porkchop");
+            unsigned threads = std::max(std::thread::hardware_concurrency(), 1u);
+            result = computePorkchop(spec, PORKCHOP_SIZE, threads);
+            pixels = porkchopPixels(result);
+            ready = true;
+            busy = false;
+        });
+        return true;
+    }
+
+    // Hands over a finished plot once.
+    bool poll()
+    {
+        return ready.exchange(false);
+    }
+};
+
+// Screen-space panel in the bottom-left corner with a marker on the best cell.
+inline void drawPorkchopOverlay(sf::RenderTarget& target, const sf::Texture& texture, const Porkchop& p, const sf::Font* font)
+{
+    const sf::View previous = target.getView();
+    target.setView(target.getDefaultView());
+
+    const sf::Vector2f size = target.getDefaultView().getSize();
+    const sf::Vector2f origin = { 10.f, size.y - PORKCHOP_PANEL - 30.f };
+
+    sf::RectangleShape panel({ PORKCHOP_PANEL + 10.f, PORKCHOP_PANEL + 30.f });
+    panel.setPosition(origin - sf::Vector2f(5.f, 5.f));
+    panel.setFillColor(sf::Color(0, 0, 0, 170));
+    target.draw(panel);
+
+    sf::Sprite sprite(texture);
+    sprite.setPosition(origin);
+    sprite.setScale({ PORKCHOP_PANEL / static_cast<float>(p.size), PORKCHOP_PANEL / static_cast<float>(p.size) });
+    target.draw(sprite);
+
+    if (std::isfinite(p.best))
+    {
+        float cell = PORKCHOP_PANEL / static_cast<float>(p.size);
+        sf::Vector2f mark = origin + sf::Vector2f(cell * p.bestDepart, cell * (p.size - 1 - p.bestArrive));
+        sf::CircleShape ring(5.f);
+        ring.setOrigin({ 5.f, 5.f });
+        ring.setPosition(mark);
+        ring.setFillColor(sf::Color::Transparent);
+        ring.setOutlineColor(sf::Color::White);
+        ring.setOutlineThickness(1.5f);
+        target.draw(ring);
+    }
+
+    if (font)
+    {
+        char label[128];
+        if (std::isfinite(p.best))
+            std::snprintf(label, sizeof(label), "best dv %.3f  depart +%.1f  tof %.1f  (%.0f ms)",
+                p.best, p.departTime(p.bestDepart) - p.spec.epoch,
+                p.arriveTime(p.bestArrive) - p.departTime(p.bestDepart), p.milliseconds);
+        else
+            std::snprintf(label, sizeof(label), "no transfer in window  (%.0f ms)", p.milliseconds);
+        sf::Text text(*font, label, 12);
+        text.setPosition(origin + sf::Vector2f(0.f, PORKCHOP_PANEL + 4.f));
+        text.setFillColor(sf::Color::White);
+        target.draw(text);
+    }
+
+    target.setView(previous);
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <initializer_list>
+
+#include "Trace.h"
+
+const size_t PROFILER_FRAMES = 300;       // ring of recent frames used for percentiles
+
+enum class FramePhase
+{
+    Events,
+    Physics,
+    Telemetry,
+    Predict,
+    Draw,
+    Present,
+    Count
+};
+
+const size_t PHASE_COUNT = static_cast<size_t>(FramePhase::Count);
+
+inline const char* phaseName(FramePhase phase)
+{
+    static const char* names[PHASE_COUNT] = { "events", "physics", "telemetry", "predict", "draw", "present" };
+    return names[static_cast<size_t>(phase)];
+}
+
+using PhaseTimes = std::array<float, PHASE_COUNT>;   // milliseconds
+
+// Per-phase frame timings. Scopes accumulate into the current frame; endFrame()
+// commits it to a fixed ring so memory and cost stay constant.
+struct FrameProfiler
+{
+    std::array<PhaseTimes, PROFILER_FRAMES> history{};
+    PhaseTimes current{};
+    size_t frames = 0;
+    bool overlayVisible = false;
+
+    void add(FramePhase phase, float ms) { current[static_cast<size_t>(phase)] += ms; }
+
+    void endFrame()
+    {
+        history[frames % PROFILER_FRAMES] = current;
+        ++frames;
+        current = {};
+    }
+
+    size_t recorded() const { return std::min(frames, PROFILER_FRAMES); }
+
+    // Time the last committed frame spent outside the given phases.
+    float lastFrameExcept(std::initializer_list<FramePhase> skip) const
+    {
+        if (frames == 0) return 0.f;
+        const PhaseTimes& f = history[(frames - 1) % PROFILER_FRAMES];
+        float total = 0.f;
+        for (size_t p = 0; p < PHASE_COUNT; ++p) total += f[p];
+        for (FramePhase p : skip) total -= f[static_cast<size_t>(p)];
+        return total;
+    }
+
+    // p in [0, 1]; phase == Count gives the whole-frame total
+    float percentile(FramePhase phase, float p) const
+    {
+        size_t n = recorded();
+        if (n == 0) return 0.f;
+
+        std::array<float, PROFILER_FRAMES> samples;
+        for (size_t i = 0; i < n; ++i)
+        {
+            const PhaseTimes& f = history[i];
+            if (phase == FramePhase::Count)
+            {
+                float total = 0.f;
+                for (float t : f) total += t;
+                samples[i] = total;
+            }
+            else
+            {
+                samples[i] = f[static_cast<size_t>(phase)];
+            }
+        }
+
+        size_t k = std::min(n - 1, static_cast<size_t>(p * static_cast<float>(n)));
+        std::nth_element(samples.begin(), samples.begin() + k, samples.begin() + n);
+        return samples[k];
+    }
+};
+
+// RAII timer: adds the elapsed wall time of its scope to one phase, and emits
+// a trace span while a capture is running.
+struct ScopedPhase
+{
+    FrameProfiler& profiler;
+    FramePhase phase;
+    std::chrono::steady_clock::time_point start;
+
+    ScopedPhase(FrameProfiler& p, FramePhase ph)
+        : profiler(p), phase(ph), start(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~ScopedPhase()
+    {
+        using namespace std::chrono;
+        steady_clock::time_point end = steady_clock::now();
+        profiler.add(phase, duration<float, std::milli>(end - start).count());
+
+        if (traceSession().active.load(std::memory_order_relaxed))
+        {
+            traceRecord(phaseName(phase),
+                duration_cast<microseconds>(start.time_since_epoch()).count(),
+                duration_cast<microseconds>(end.time_since_epoch()).count());
+        }
+    }
+
+    ScopedPhase(const ScopedPhase&) = delete;
+    ScopedPhase& operator=(const ScopedPhase&) = delete;
+};
+
+// Screen-space overlay: a bar per phase (p50 solid, p99 tick) scaled to a
+// 60 Hz frame, with text labels when a font could be loaded.
+inline void drawProfilerOverlay(sf::RenderTarget& target, const FrameProfiler& profiler, const sf::Font* font)
+{
+    if (!profiler.overlayVisible) return;
+
+    const sf::View previous = target.getView();
+    target.setView(target.getDefaultView());
+
+    const float frameBudget = 1000.f / 60.f;
+    const float barWidth = 220.f;
+    const float rowHeight = 18.f;
+    const sf::Vector2f origin = { 10.f, 10.f };
+    const size_t rows = PHASE_COUNT + 1;
+
+    sf::RectangleShape panel({ 430.f, rowHeight * static_cast<float>(rows) + 10.f });
+    panel.setPosition(origin - sf::Vector2f(5.f, 5.f));
+    panel.setFillColor(sf::Color(0, 0, 0, 170));
+    target.draw(panel);
+
+    sf::VertexArray bars(sf::PrimitiveType::Triangles);
+    auto quad = [&bars](sf::Vector2f pos, sf::Vector2f size, sf::Color c)
+    {
+        sf::Vector2f a = pos, b = pos + sf::Vector2f(size.x, 0.f);
+        sf::Vector2f d = pos + sf::Vector2f(0.f, size.y), e = pos + size;
+        bars.append({ a, c }); bars.append({ b, c }); bars.append({ e, c });
+        bars.append({ a, c }); bars.append({ e, c }); bars.append({ d, c });
+    };
+
+    char label[96];
+    for (size_t row = 0; row < rows; ++row)
+    {
+        FramePhase phase = row < PHASE_COUNT ? static_cast<FramePhase>(row) : FramePhase::Count;
+        float p50 = profiler.percentile(phase, 0.5f);
+        float p99 = profiler.percentile(phase, 0.99f);
+
+        sf::Vector2f pos = origin + sf::Vector2f(200.f, rowHeight * static_cast<float>(row) + 3.f);
+        float w50 = std::min(p50 / frameBudget, 1.f) * barWidth;
+        float w99 = std::min(p99 / frameBudget, 1.f) * barWidth;
+        sf::Color color = phase == FramePhase::Count ? sf::Color(255, 200, 80) : sf::Color(80, 200, 255);
+        quad(pos, { std::max(w50, 1.f), rowHeight - 6.f }, color);
+        quad(pos + sf::Vector2f(w99, -2.f), { 2.f, rowHeight - 2.f }, sf::Color::Red);
+
+        if (font)
+        {
+            std::snprintf(label, sizeof(label), "%-9s %6.2f %6.2f",
+                phase == FramePhase::Count ? "frame" : phaseName(phase), p50, p99);
+            sf::Text text(*font, label, 12);
+            text.setPosition(origin + sf::Vector2f(0.f, rowHeight * static_cast<float>(row)));
+            text.setFillColor(sf::Color::White);
+            target.draw(text);
+        }
+    }
+
+    target.draw(bars);
+    target.setView(previous);
+}
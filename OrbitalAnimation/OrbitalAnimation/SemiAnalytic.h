@@ -0,0 +1,453 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "Ensemble.h"
+#include "Kepler.h"
+#include "Parallel.h"
+#include "Physics.h"
+
+// Semi-analytic propagation: mean equinoctial elements (a, ex, ey, lambda)
+// advanced with their orbit-averaged rates, many revolutions per step. The
+// rates come from Gauss's equations for a, the eccentricity vector and
+// lambda, averaged by the trapezoid rule over equally spaced eccentric
+// longitudes. The integrand is periodic, so the trapezoid rule converges
+// spectrally. The same nodes give the first-order short-period terms of a and e,
+// which turn mean elements back into an osculating state for display.
+//
+// Averaging only holds while the orbit changes little per revolution. When
+// it does not, for example in the last plunge through the atmosphere or
+// under a strong tangential drift, the caller integrates a revolution
+// numerically and re-averages.
+
+const int SEMI_NODES = 16;                 // quadrature nodes per revolution
+const double SEMI_REVS_PER_STEP = 1000.0;  // cap when nothing else limits the step
+const double SEMI_MAX_STEP_CHANGE = 0.02;  // relative change of a (absolute of e) per step
+const double SEMI_MAX_REV_CHANGE = 0.005;  // per revolution, beyond which averaging is abandoned
+const double SEMI_MAX_ECCENTRICITY = 0.9;
+const int SEMI_COWELL_STEPS_PER_REV = 4096;
+
+// Equinoctial elements of a bound orbit. Clockwise orbits are mirrored (y -> -y)
+// so the elements always describe a counter-clockwise ellipse.
+struct MeanElements
+{
+    double a = 0.0;
+    double ex = 0.0, ey = 0.0;    // eccentricity vector
+    double lambda = 0.0;          // mean longitude, not wrapped
+    bool clockwise = false;
+
+    double eccentricity() const { return std::sqrt(ex * ex + ey * ey); }
+    double periapsis() const { return a * (1.0 - eccentricity()); }
+};
+
+inline Vec2d mirrorIf(Vec2d x, bool mirror) { return mirror ? Vec2d(x.x, -x.y) : x; }
+
+// Position and velocity at eccentric longitude F (counter-clockwise frame).
+inline KeplerState stateAtLongitude(const MeanElements& el, double F, double mu)
+{
+    const double e2 = el.ex * el.ex + el.ey * el.ey;
+    const double beta = 1.0 / (1.0 + std::sqrt(1.0 - e2));
+    const double c = std::cos(F), s = std::sin(F);
+    const double r = el.a * (1.0 - el.ex * c - el.ey * s);
+    const double vScale = std::sqrt(mu * el.a) / r;
+
+    KeplerState st;
+    st.r = Vec2d(el.a * ((1.0 - el.ey * el.ey * beta) * c + el.ex * el.ey * beta * s - el.ex),
+                 el.a * ((1.0 - el.ex * el.ex * beta) * s + el.ex * el.ey * beta * c - el.ey));
+    st.v = Vec2d(vScale * (el.ex * el.ey * beta * c - (1.0 - el.ey * el.ey * beta) * s),
+                 vScale * ((1.0 - el.ex * el.ex * beta) * c - el.ex * el.ey * beta * s));
+    return st;
+}
+
+// Solves lambda = F - ex sin F + ey cos F.
+inline double eccentricLongitude(const MeanElements& el)
+{
+    double F = el.lambda;
+    for (int it = 0; it < 20; ++it)
+    {
+        double c = std::cos(F), s = std::sin(F);
+        double step = (F - el.ex * s + el.ey * c - el.lambda) / (1.0 - el.ex * c - el.ey * s);
+        F -= step;
+        if (std::abs(step) < 1e-14) break;
+    }
+    return F;
+}
+
+// Osculating elements of a state relative to the central body; false if unbound.
+inline bool elementsOf(const KeplerState& state, double mu, MeanElements& el)
+{
+    el.clockwise = cross(state.r, state.v) < 0.0;
+    Vec2d r = mirrorIf(state.r, el.clockwise), v = mirrorIf(state.v, el.clockwise);
+    double rn = norm(r), v2 = dot(v, v);
+
+    double inverseA = 2.0 / rn - v2 / mu;
+    if (!(inverseA > 0.0)) return false;
+    el.a = 1.0 / inverseA;
+    Vec2d e = (r * (v2 - mu / rn) - v * dot(r, v)) / mu;
+    el.ex = e.x;
+    el.ey = e.y;
+    if (!(el.eccentricity() < 1.0)) return false;
+
+    // invert the position formula for (cos F, sin F): a 2x2 linear system
+    const double beta = 1.0 / (1.0 + std::sqrt(1.0 - dot(e, e)));
+    double m00 = 1.0 - el.ey * el.ey * beta, m11 = 1.0 - el.ex * el.ex * beta, m01 = el.ex * el.ey * beta;
+    double bx = r.x / el.a + el.ex, by = r.y / el.a + el.ey;
+    double det = m00 * m11 - m01 * m01;
+    double c = (m11 * bx - m01 * by) / det, s = (m00 * by - m01 * bx) / det;
+    double F = std::atan2(s, c);
+    el.lambda = F - el.ex * std::sin(F) + el.ey * std::cos(F);
+    return true;
+}
+
+inline KeplerState stateOf(const MeanElements& el, double mu)
+{
+    KeplerState s = stateAtLongitude(el, eccentricLongitude(el), mu);
+    return { mirrorIf(s.r, el.clockwise), mirrorIf(s.v, el.clockwise) };
+}
+
+// d/dt of (a, ex, ey, lambda).
+using ElementRates = std::array<double, 4>;
+
+// First-order short-period deviation of (a, ex, ey) at each node, zero mean.
+struct ShortPeriodTerms
+{
+    std::array<std::array<double, 3>, SEMI_NODES> delta{};
+
+    // at eccentric longitude F, linear between nodes
+    std::array<double, 3> at(double F) const
+    {
+        double u = F / (2.0 * KEPLER_PI) * SEMI_NODES;
+        u -= std::floor(u / SEMI_NODES) * SEMI_NODES;
+        int i = std::min(static_cast<int>(u), SEMI_NODES - 1);
+        int j = (i + 1) % SEMI_NODES;
+        double f = u - i;
+        return { delta[i][0] + (delta[j][0] - delta[i][0]) * f,
+                 delta[i][1] + (delta[j][1] - delta[i][1]) * f,
+                 delta[i][2] + (delta[j][2] - delta[i][2]) * f };
+    }
+};
+
+// Orbit-averaged rates under perturb(r, v), the non-Keplerian acceleration in
+// the unmirrored frame. lambda advances at the mean motion of the current a;
+// its own short-period and second-order terms are left out.
+template <typename Perturbation>
+inline ElementRates averagedRates(const MeanElements& el, double mu, const Perturbation& perturb,
+    ShortPeriodTerms* shortPeriod = nullptr)
+{
+    const double n = std::sqrt(mu / (el.a * el.a * el.a));
+    const double period = 2.0 * KEPLER_PI / n;
+
+    std::array<std::array<double, 3>, SEMI_NODES> rate;
+    std::array<double, SEMI_NODES> dt;
+    std::array<double, 3> mean = { 0.0, 0.0, 0.0 };
+    for (int k = 0; k < SEMI_NODES; ++k)
+    {
+        double F = 2.0 * KEPLER_PI * k / SEMI_NODES;
+        KeplerState s = stateAtLongitude(el, F, mu);
+        Vec2d f = mirrorIf(perturb(mirrorIf(s.r, el.clockwise), mirrorIf(s.v, el.clockwise)), el.clockwise);
+
+        double h = cross(s.r, s.v), hDot = cross(s.r, f);
+        rate[k] = { 2.0 * el.a * el.a * dot(s.v, f) / mu,
+                    (f.y * h + s.v.y * hDot) / mu,
+                    (-f.x * h - s.v.x * hDot) / mu };
+
+        // time spent around this node: dlambda / n, with dlambda/dF = r / a
+        dt[k] = period / SEMI_NODES * norm(s.r) / el.a;
+        for (int d = 0; d < 3; ++d) mean[d] += rate[k][d] * dt[k] / period;
+    }
+
+    if (shortPeriod)
+    {
+        std::array<double, 3> running = { 0.0, 0.0, 0.0 }, offset = { 0.0, 0.0, 0.0 };
+        for (int k = 0; k < SEMI_NODES; ++k)
+        {
+            shortPeriod->delta[k] = running;
+            for (int d = 0; d < 3; ++d)
+            {
+                offset[d] += running[d] * dt[k] / period;
+                running[d] += (rate[k][d] - mean[d]) * dt[k];
+            }
+        }
+        for (auto& node : shortPeriod->delta)
+            for (int d = 0; d < 3; ++d) node[d] -= offset[d];
+    }
+
+    return { mean[0], mean[1], mean[2], n };
+}
+
+// Mean elements whose reconstructed osculating state is s (one fixed-point pass).
+template <typename Perturbation>
+inline bool meanElementsOf(const KeplerState& s, double mu, const Perturbation& perturb, MeanElements& el)
+{
+    if (!elementsOf(s, mu, el)) return false;
+    ShortPeriodTerms sp;
+    averagedRates(el, mu, perturb, &sp);
+    std::array<double, 3> d = sp.at(eccentricLongitude(el));
+    el.a -= d[0];
+    el.ex -= d[1];
+    el.ey -= d[2];
+    return el.a > 0.0 && el.eccentricity() < 1.0;
+}
+
+// State to display: the mean orbit, plus the short-period terms when asked.
+template <typename Perturbation>
+inline KeplerState osculatingState(MeanElements el, double mu, const Perturbation& perturb, bool shortPeriod)
+{
+    if (shortPeriod)
+    {
+        ShortPeriodTerms sp;
+        averagedRates(el, mu, perturb, &sp);
+        std::array<double, 3> d = sp.at(eccentricLongitude(el));
+        el.a += d[0];
+        el.ex += d[1];
+        el.ey += d[2];
+    }
+    return stateOf(el, mu);
+}
+
+// One RK4 step of the averaged equations; k1 are the rates at el.
+template <typename Perturbation>
+inline void stepMeanElements(MeanElements& el, double h, double mu, const Perturbation& perturb, const ElementRates& k1)
+{
+    auto shifted = [&el](const ElementRates& k, double f)
+    {
+        MeanElements m = el;
+        m.a += k[0] * f; m.ex += k[1] * f; m.ey += k[2] * f; m.lambda += k[3] * f;
+        return m;
+    };
+    ElementRates k2 = averagedRates(shifted(k1, 0.5 * h), mu, perturb);
+    ElementRates k3 = averagedRates(shifted(k2, 0.5 * h), mu, perturb);
+    ElementRates k4 = averagedRates(shifted(k3, h), mu, perturb);
+    el.a += (k1[0] + 2.0 * k2[0] + 2.0 * k3[0] + k4[0]) * (h / 6.0);
+    el.ex += (k1[1] + 2.0 * k2[1] + 2.0 * k3[1] + k4[1]) * (h / 6.0);
+    el.ey += (k1[2] + 2.0 * k2[2] + 2.0 * k3[2] + k4[2]) * (h / 6.0);
+    el.lambda += (k1[3] + 2.0 * k2[3] + 2.0 * k3[3] + k4[3]) * (h / 6.0);
+}
+
+// Takes one averaged step of at most h, halving it while the result moves
+// further than the step control allows; the rates can steepen inside a step,
+// for example on the way down into the atmosphere. Returns the step taken, or 0
+// if no step down to one revolution is acceptable.
+template <typename Perturbation>
+inline double advanceMeanElements(MeanElements& el, double h, double mu, const Perturbation& perturb, const ElementRates& rates)
+{
+    const double smallest = std::min(h, 2.0 * KEPLER_PI / rates[3]);
+    for (; h >= smallest; h *= 0.5)
+    {
+        MeanElements trial = el;
+        stepMeanElements(trial, h, mu, perturb, rates);
+        if (std::isfinite(trial.a) && std::abs(trial.a - el.a) <= 2.0 * SEMI_MAX_STEP_CHANGE * el.a
+            && trial.eccentricity() < SEMI_MAX_ECCENTRICITY)
+        {
+            el = trial;
+            return h;
+        }
+    }
+    return 0.0;
+}
+
+// Step that keeps the per-step change of a and e small, or 0 if the orbit
+// changes too fast per revolution for averaging to be meaningful.
+inline double meanElementStep(const MeanElements& el, const ElementRates& rates)
+{
+    const double period = 2.0 * KEPLER_PI / rates[3];
+    const double aRate = std::abs(rates[0]) / el.a;
+    const double eRate = std::sqrt(rates[1] * rates[1] + rates[2] * rates[2]);
+    if (std::max(aRate, eRate) * period > SEMI_MAX_REV_CHANGE) return 0.0;
+    if (el.eccentricity() > SEMI_MAX_ECCENTRICITY) return 0.0;
+
+    double h = SEMI_REVS_PER_STEP * period;
+    if (aRate > 0.0) h = std::min(h, SEMI_MAX_STEP_CHANGE / aRate);
+    if (eRate > 0.0) h = std::min(h, SEMI_MAX_STEP_CHANGE / eRate);
+    return h;
+}
+
+// Lifetime study: a population on near-circular orbits, each followed to
+// re-entry, escape or the end of the horizon. Orbits come from the counter-
+// based generator, so the population is the same on any number of threads.
+struct LifetimeSpec
+{
+    uint64_t objects = 1000;
+    uint64_t seed = 1;
+    double duration = 1e7;
+    double year = 0.0;            // sim seconds per year, for the report; 0 leaves years out
+    double minRadius = 0.0, maxRadius = 0.0;
+    double maxEccentricity = 0.0;
+    double surfaceRadius = 0.0;
+    double escapeRadius = 1e9;
+};
+
+struct LifetimeStats
+{
+    uint64_t objects = 0;
+    uint64_t reentered = 0, escaped = 0, survived = 0;
+    RunningStat lifetime;
+    std::array<uint64_t, ENSEMBLE_BINS> lifetimeHistogram{};
+    uint64_t meanSteps = 0;       // semi-analytic steps taken
+    uint64_t cowellRevs = 0;      // revolutions integrated numerically
+    double milliseconds = 0.0;
+
+    void merge(const LifetimeStats& o)
+    {
+        objects += o.objects;
+        reentered += o.reentered;
+        escaped += o.escaped;
+        survived += o.survived;
+        lifetime.merge(o.lifetime);
+        for (int b = 0; b < ENSEMBLE_BINS; ++b) lifetimeHistogram[b] += o.lifetimeHistogram[b];
+        meanSteps += o.meanSteps;
+        cowellRevs += o.cowellRevs;
+    }
+};
+
+inline KeplerState lifetimeObject(const LifetimeSpec& spec, uint64_t k, double mu)
+{
+    auto bits = philox4x32({ uint32_t(k), uint32_t(k >> 32), 1u, 0u }, { uint32_t(spec.seed), uint32_t(spec.seed >> 32) });
+
+    MeanElements el;
+    double e = spec.maxEccentricity * uniform01(bits[1]);
+    double omega = 2.0 * KEPLER_PI * uniform01(bits[2]);
+    // periapsis within [minRadius, maxRadius]
+    el.a = (spec.minRadius + (spec.maxRadius - spec.minRadius) * uniform01(bits[0])) / (1.0 - e);
+    el.ex = e * std::cos(omega);
+    el.ey = e * std::sin(omega);
+    el.lambda = 2.0 * KEPLER_PI * uniform01(bits[3]);
+    return stateOf(el, mu);
+}
+
+// Follows one object and folds its outcome into stats.
+inline void runLifetimeObject(const LifetimeSpec& spec, const ForceModel& force, const KeplerState& start,
+    LifetimeStats& stats)
+{
+    const double mu = force.mu;
+    auto perturb = [&force, mu](Vec2d x, Vec2d v)
+    {
+        double r = norm(x);
+        return accelerationAt(force, x, v) + x * (mu / (r * r * r));
+    };
+
+    double t = 0.0;
+    KeplerState s = start;
+    ++stats.objects;
+
+    auto reentry = [&](double when)
+    {
+        ++stats.reentered;
+        stats.lifetime.add(when);
+        int bin = std::min(static_cast<int>(when / spec.duration * ENSEMBLE_BINS), ENSEMBLE_BINS - 1);
+        ++stats.lifetimeHistogram[bin];
+    };
+
+    while (t < spec.duration)
+    {
+        MeanElements el;
+        ElementRates rates{};
+        double h = 0.0;
+        if (meanElementsOf(s, mu, perturb, el))
+        {
+            rates = averagedRates(el, mu, perturb);
+            h = meanElementStep(el, rates);
+        }
+        if (h > 0.0)
+        {
+            while (h > 0.0)
+            {
+                double taken = advanceMeanElements(el, std::min(h, spec.duration - t), mu, perturb, rates);
+                if (taken == 0.0) break;
+                t += taken;
+                ++stats.meanSteps;
+                if (el.a * (1.0 + el.eccentricity()) > spec.escapeRadius)
+                {
+                    ++stats.escaped;
+                    return;
+                }
+                if (el.periapsis() <= spec.surfaceRadius)
+                {
+                    reentry(t);
+                    return;
+                }
+                if (t >= spec.duration)
+                {
+                    ++stats.survived;
+                    return;
+                }
+                rates = averagedRates(el, mu, perturb);
+                h = meanElementStep(el, rates);
+            }
+            s = osculatingState(el, mu, perturb, true);
+        }
+
+        // averaging does not hold: one revolution (or flyby time scale) by RK4
+        ++stats.cowellRevs;
+        const double dt = orbitTimescale(s, mu) / SEMI_COWELL_STEPS_PER_REV;
+        for (int i = 0; i < SEMI_COWELL_STEPS_PER_REV && t < spec.duration; ++i)
+        {
+            Vec2d k1v = accelerationAt(force, s.r, s.v), k1r = s.v;
+            Vec2d k2r = s.v + k1v * (0.5 * dt), k2v = accelerationAt(force, s.r + k1r * (0.5 * dt), k2r);
+            Vec2d k3r = s.v + k2v * (0.5 * dt), k3v = accelerationAt(force, s.r + k2r * (0.5 * dt), k3r);
+            Vec2d k4r = s.v + k3v * dt, k4v = accelerationAt(force, s.r + k3r * dt, k4r);
+            s.r += (k1r + k2r * 2.0 + k3r * 2.0 + k4r) * (dt / 6.0);
+            s.v += (k1v + k2v * 2.0 + k3v * 2.0 + k4v) * (dt / 6.0);
+            t += dt;
+
+            double r = norm(s.r);
+            if (r < spec.surfaceRadius)
+            {
+                reentry(t);
+                return;
+            }
+            if (r > spec.escapeRadius)
+            {
+                ++stats.escaped;
+                return;
+            }
+        }
+    }
+    ++stats.survived;
+}
+
+// force.center is ignored: objects are followed relative to the central body.
+inline LifetimeStats runLifetime(const LifetimeSpec& spec, ForceModel force, unsigned threads)
+{
+    auto start = std::chrono::steady_clock::now();
+    force.center = { 0.f, 0.f };
+
+    std::vector<LifetimeStats> locals(parallelWorkers(threads));
+    parallelFor(static_cast<size_t>(spec.objects), 1, threads, "lifetime", [&](size_t first, size_t last, unsigned worker)
+    {
+        for (size_t k = first; k < last; ++k)
+            runLifetimeObject(spec, force, lifetimeObject(spec, k, force.mu), locals[worker]);
+    });
+
+    LifetimeStats total;
+    for (const LifetimeStats& local : locals) total.merge(local);
+    total.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return total;
+}
+
+inline void printLifetime(const LifetimeSpec& spec, const LifetimeStats& s)
+{
+    auto fraction = [&s](uint64_t k) { return s.objects ? static_cast<double>(k) / static_cast<double>(s.objects) : 0.0; };
+    std::printf("lifetime %llu objects over %.3g s", static_cast<unsigned long long>(s.objects), spec.duration);
+    if (spec.year > 0.0) std::printf(" (%.3g years)", spec.duration / spec.year);
+    std::printf(", seed %llu: %.0f ms (%llu averaged steps, %llu numerical revolutions)\n",
+        static_cast<unsigned long long>(spec.seed), s.milliseconds,
+        static_cast<unsigned long long>(s.meanSteps), static_cast<unsigned long long>(s.cowellRevs));
+    std::printf("  re-entered %.4f  (%llu)\n", fraction(s.reentered), static_cast<unsigned long long>(s.reentered));
+    std::printf("  escaped    %.4f  (%llu)\n", fraction(s.escaped), static_cast<unsigned long long>(s.escaped));
+    std::printf("  in orbit   %.4f  (%llu)\n", fraction(s.survived), static_cast<unsigned long long>(s.survived));
+    if (s.lifetime.n)
+    {
+        std::printf("  lifetime mean %.4g sd %.4g [%.4g %.4g]\n",
+            s.lifetime.mean, s.lifetime.stddev(), s.lifetime.lo, s.lifetime.hi);
+        std::printf("  re-entry histogram (%d bins over the horizon):", ENSEMBLE_BINS);
+        for (uint64_t c : s.lifetimeHistogram) std::printf(" %llu", static_cast<unsigned long long>(c));
+        std::printf("\n");
+    }
+}
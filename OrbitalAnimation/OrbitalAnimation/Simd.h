@@ -0,0 +1,154 @@
+#pragma once
+
+#include <emmintrin.h>
+#include <cstdint>
+
+// Four float lanes on SSE2 (baseline on both x86 and x64 builds).
+// Kept deliberately small: only what the batch kernels actually use.
+struct f32x4
+{
+    __m128 v;
+
+    f32x4() : v(_mm_setzero_ps()) {}
+    f32x4(__m128 x) : v(x) {}
+    explicit f32x4(float s) : v(_mm_set1_ps(s)) {}
+    f32x4(float a, float b, float c, float d) : v(_mm_setr_ps(a, b, c, d)) {}
+
+    static f32x4 load(const float* p) { return _mm_loadu_ps(p); }
+    void store(float* p) const { _mm_storeu_ps(p, v); }
+};
+
+inline f32x4 operator+(f32x4 a, f32x4 b) { return _mm_add_ps(a.v, b.v); }
+inline f32x4 operator-(f32x4 a, f32x4 b) { return _mm_sub_ps(a.v, b.v); }
+inline f32x4 operator*(f32x4 a, f32x4 b) { return _mm_mul_ps(a.v, b.v); }
+inline f32x4 operator/(f32x4 a, f32x4 b) { return _mm_div_ps(a.v, b.v); }
+inline f32x4 operator-(f32x4 a) { return _mm_sub_ps(_mm_setzero_ps(), a.v); }
+inline f32x4& operator+=(f32x4& a, f32x4 b) { a = a + b; return a; }
+inline f32x4& operator-=(f32x4& a, f32x4 b) { a = a - b; return a; }
+inline f32x4& operator*=(f32x4& a, f32x4 b) { a = a * b; return a; }
+inline f32x4& operator/=(f32x4& a, f32x4 b) { a = a / b; return a; }
+
+// comparisons return all-ones / all-zeros lane masks
+inline f32x4 operator<(f32x4 a, f32x4 b) { return _mm_cmplt_ps(a.v, b.v); }
+inline f32x4 operator<=(f32x4 a, f32x4 b) { return _mm_cmple_ps(a.v, b.v); }
+inline f32x4 operator>(f32x4 a, f32x4 b) { return _mm_cmpgt_ps(a.v, b.v); }
+inline f32x4 operator>=(f32x4 a, f32x4 b) { return _mm_cmpge_ps(a.v, b.v); }
+inline f32x4 operator&(f32x4 a, f32x4 b) { return _mm_and_ps(a.v, b.v); }
+inline f32x4 operator|(f32x4 a, f32x4 b) { return _mm_or_ps(a.v, b.v); }
+
+inline f32x4 sqrt(f32x4 a) { return _mm_sqrt_ps(a.v); }
+inline f32x4 min(f32x4 a, f32x4 b) { return _mm_min_ps(a.v, b.v); }
+inline f32x4 max(f32x4 a, f32x4 b) { return _mm_max_ps(a.v, b.v); }
+inline f32x4 abs(f32x4 a) { return _mm_andnot_ps(_mm_set1_ps(-0.f), a.v); }
+
+// mask ? a : b
+inline f32x4 select(f32x4 mask, f32x4 a, f32x4 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v));
+}
+
+inline bool any(f32x4 mask) { return _mm_movemask_ps(mask.v) != 0; }
+
+inline float hsum(f32x4 a)
+{
+    alignas(16) float t[4];
+    _mm_store_ps(t, a.v);
+    return (t[0] + t[1]) + (t[2] + t[3]);
+}
+
+inline float hmin(f32x4 a)
+{
+    __m128 s = _mm_min_ps(a.v, _mm_shuffle_ps(a.v, a.v, _MM_SHUFFLE(1, 0, 3, 2)));
+    s = _mm_min_ps(s, _mm_shuffle_ps(s, s, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtss_f32(s);
+}
+
+inline float hmax(f32x4 a)
+{
+    __m128 s = _mm_max_ps(a.v, _mm_shuffle_ps(a.v, a.v, _MM_SHUFFLE(1, 0, 3, 2)));
+    s = _mm_max_ps(s, _mm_shuffle_ps(s, s, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtss_f32(s);
+}
+
+// unbiased binary exponent of each lane (floor(log2|x|) for normal floats)
+inline void exponents(f32x4 a, std::int32_t* out)
+{
+    __m128i bits = _mm_castps_si128(abs(a).v);
+    __m128i e = _mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), e);
+}
+
+// Cephes-style single precision log, exp and acos; a few ulp over the ranges
+// the kernels use. log expects positive normal floats.
+inline f32x4 log(f32x4 x)
+{
+    __m128i bits = _mm_castps_si128(x.v);
+    f32x4 e = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(126)));
+    f32x4 m = _mm_or_ps(_mm_and_ps(x.v, _mm_castsi128_ps(_mm_set1_epi32(0x007fffff))), _mm_set1_ps(0.5f));   // [0.5, 1)
+
+    // keep the mantissa within [sqrt(1/2), sqrt(2)) - 1
+    f32x4 small = m < f32x4(0.707106781f);
+    e = e - (small & f32x4(1.f));
+    m = m + (small & m) - f32x4(1.f);
+
+    f32x4 z = m * m;
+    f32x4 y(7.0376836292e-2f);
+    y = y * m + f32x4(-1.1514610310e-1f);
+    y = y * m + f32x4(1.1676998740e-1f);
+    y = y * m + f32x4(-1.2420140846e-1f);
+    y = y * m + f32x4(1.4249322787e-1f);
+    y = y * m + f32x4(-1.6668057665e-1f);
+    y = y * m + f32x4(2.0000714765e-1f);
+    y = y * m + f32x4(-2.4999993993e-1f);
+    y = y * m + f32x4(3.3333331174e-1f);
+    y = y * m * z + e * f32x4(-2.12194440e-4f) - z * f32x4(0.5f);
+    return m + y + e * f32x4(0.693359375f);
+}
+
+inline f32x4 exp(f32x4 x)
+{
+    x = min(max(x, f32x4(-87.3f)), f32x4(88.3f));
+
+    // x = n ln2 + r with n = round(x / ln2)
+    f32x4 fx = x * f32x4(1.44269504088896341f) + f32x4(0.5f);
+    f32x4 n = _mm_cvtepi32_ps(_mm_cvttps_epi32(fx.v));
+    n = n - ((n > fx) & f32x4(1.f));                     // floor
+    x = x - n * f32x4(0.693359375f) + n * f32x4(2.12194440e-4f);
+
+    f32x4 z = x * x;
+    f32x4 y(1.9875691500e-4f);
+    y = y * x + f32x4(1.3981999507e-3f);
+    y = y * x + f32x4(8.3334519073e-3f);
+    y = y * x + f32x4(4.1665795894e-2f);
+    y = y * x + f32x4(1.6666665459e-1f);
+    y = y * x + f32x4(5.0000001201e-1f);
+    y = y * z + x + f32x4(1.f);
+
+    __m128i scale = _mm_slli_epi32(_mm_add_epi32(_mm_cvttps_epi32(n.v), _mm_set1_epi32(127)), 23);
+    return y * f32x4(_mm_castsi128_ps(scale));
+}
+
+// x in [-1, 1]. Near +-1 it works from sqrt((1 - |x|) / 2) so the result keeps
+// full relative precision where acos is small.
+inline f32x4 acos(f32x4 x)
+{
+    const f32x4 halfPi(1.57079632679f), pi(3.14159265359f);
+    f32x4 a = abs(x);
+    f32x4 big = a > f32x4(0.5f);
+    f32x4 z = select(big, f32x4(0.5f) * (f32x4(1.f) - a), a * a);
+    f32x4 s = select(big, sqrt(z), a);
+
+    // asin(s) for s in [0, 0.5]
+    f32x4 p(4.2163199048e-2f);
+    p = p * z + f32x4(2.4181311049e-2f);
+    p = p * z + f32x4(4.5470025998e-2f);
+    p = p * z + f32x4(7.4953002686e-2f);
+    p = p * z + f32x4(1.6666752422e-1f);
+    p = p * z * s + s;
+
+    f32x4 negative = x < f32x4(0.f);
+    f32x4 twice = p + p;
+    f32x4 nearOne = select(negative, pi - twice, twice);
+    f32x4 central = halfPi - select(negative, -p, p);
+    return select(big, nearOne, central);
+}
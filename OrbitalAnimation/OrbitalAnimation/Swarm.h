@@ -0,0 +1,205 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Ensemble.h"
+#include "Kepler.h"
+#include "Physics.h"
+
+// Bulk populations for large scenarios and stress tests. Swarm bodies have
+// no trail, shape, events or covariance: each is one slot in a pool of
+// fixed-capacity structure-of-arrays blocks, stepped by the same kernel as the
+// satellites and drawn as a point. Blocks are reserved ahead of use and never
+// grow, so spawning thousands of bodies in one step allocates at most a few
+// fresh blocks and never moves the bodies already there.
+
+const size_t SWARM_BLOCK = 16384;          // bodies per pool block
+
+enum class SwarmKind : uint8_t { Constellation, Shell, Debris, Fragment };
+
+struct SwarmBlock
+{
+    BodyBatch bodies;             // world coordinates, like the block batches
+    std::vector<SwarmKind> kind;
+    std::vector<float> mass;      // kg, for the breakup model
+    std::vector<float> armed;     // sim time from which the body can collide
+
+    SwarmBlock()
+    {
+        // + 3 so stepBatch's padding stays inside the reservation
+        for (std::vector<float>* a : { &bodies.px, &bodies.py, &bodies.vx, &bodies.vy }) a->reserve(SWARM_BLOCK + 3);
+        kind.reserve(SWARM_BLOCK);
+        mass.reserve(SWARM_BLOCK);
+        armed.reserve(SWARM_BLOCK);
+    }
+
+    size_t size() const { return kind.size(); }
+
+    void clear()
+    {
+        bodies.clear();
+        kind.clear();
+        mass.clear();
+        armed.clear();
+    }
+};
+
+struct Swarm
+{
+    std::vector<std::unique_ptr<SwarmBlock>> blocks;   // in use; only the last one takes new bodies
+    std::vector<std::unique_ptr<SwarmBlock>> spare;    // reserved and empty
+    size_t count = 0;
+
+    size_t size() const { return count; }
+
+    // Have enough spare blocks for n more bodies, so the pushes that follow
+    // do not allocate.
+    void reserve(size_t n)
+    {
+        size_t room = blocks.empty() ? 0 : SWARM_BLOCK - blocks.back()->size();
+        while (room + spare.size() * SWARM_BLOCK < n) spare.push_back(std::make_unique<SwarmBlock>());
+    }
+
+    void push(sf::Vector2f center, const KeplerState& s, SwarmKind k, float mass, float armed)
+    {
+        if (blocks.empty() || blocks.back()->size() == SWARM_BLOCK)
+        {
+            if (spare.empty()) spare.push_back(std::make_unique<SwarmBlock>());
+            blocks.push_back(std::move(spare.back()));
+            spare.pop_back();
+        }
+        SwarmBlock& b = *blocks.back();
+        b.bodies.push({ center.x + static_cast<float>(s.r.x), center.y + static_cast<float>(s.r.y) },
+                      { static_cast<float>(s.v.x), static_cast<float>(s.v.y) });
+        b.kind.push_back(k);
+        b.mass.push_back(mass);
+        b.armed.push_back(armed);
+        ++count;
+    }
+
+    // Swap-remove every body inside the surface within its block; emptied
+    // blocks go back to the spare list. Returns how many bodies went.
+    size_t cull(sf::Vector2f center, float surfaceRadius)
+    {
+        const float surface2 = surfaceRadius * surfaceRadius;
+        const size_t before = count;
+        for (size_t bi = 0; bi < blocks.size();)
+        {
+            SwarmBlock& b = *blocks[bi];
+            size_t n = b.size();
+            for (size_t i = 0; i < n;)
+            {
+                float dx = b.bodies.px[i] - center.x, dy = b.bodies.py[i] - center.y;
+                if (dx * dx + dy * dy >= surface2) { ++i; continue; }
+                --n;
+                b.bodies.px[i] = b.bodies.px[n]; b.bodies.py[i] = b.bodies.py[n];
+                b.bodies.vx[i] = b.bodies.vx[n]; b.bodies.vy[i] = b.bodies.vy[n];
+                b.kind[i] = b.kind[n]; b.mass[i] = b.mass[n]; b.armed[i] = b.armed[n];
+            }
+            count -= b.size() - n;
+            for (std::vector<float>* a : { &b.bodies.px, &b.bodies.py, &b.bodies.vx, &b.bodies.vy }) a->resize(n);
+            b.kind.resize(n); b.mass.resize(n); b.armed.resize(n);
+
+            if (n == 0)
+            {
+                spare.push_back(std::move(blocks[bi]));
+                blocks.erase(blocks.begin() + static_cast<long>(bi));
+                continue;
+            }
+            ++bi;
+        }
+        return before - count;
+    }
+
+    // Park a body at the center; the next cull removes it.
+    void remove(size_t block, size_t i, sf::Vector2f center)
+    {
+        blocks[block]->bodies.px[i] = center.x;
+        blocks[block]->bodies.py[i] = center.y;
+    }
+
+    void clear()
+    {
+        for (auto& b : blocks)
+        {
+            b->clear();
+            spare.push_back(std::move(b));
+        }
+        blocks.clear();
+        count = 0;
+    }
+
+    void step(const ForceModel& force, float dt)
+    {
+        for (auto& b : blocks) stepBatch(force, b->bodies, dt);
+    }
+};
+
+// Circular orbit of radius r at angle theta, counter-clockwise like click spawns.
+inline KeplerState circularAt(double r, double theta, double mu)
+{
+    Vec2d dir(std::cos(theta), std::sin(theta));
+    return { dir * r, Vec2d(-dir.y, dir.x) * std::sqrt(mu / r) };
+}
+
+// Walker-style delta pattern flattened to the plane: `planes` rings of
+// total / planes bodies, each ring spacing higher than the last, ring p
+// phased by p * phasing * 2 pi / total.
+struct WalkerSpec
+{
+    int total = 0, planes = 1, phasing = 0;
+    double radius = 0.0;          // lowest ring
+    double spacing = 0.0;         // radial step between rings
+    float mass = 0.f;             // per satellite
+};
+
+inline size_t spawnWalker(Swarm& swarm, const WalkerSpec& w, sf::Vector2f center, double mu, float armed)
+{
+    const int perPlane = w.total / std::max(w.planes, 1);
+    if (perPlane <= 0) return 0;
+    swarm.reserve(static_cast<size_t>(perPlane) * w.planes);
+    for (int p = 0; p < w.planes; ++p)
+    {
+        double r = w.radius + w.spacing * p;
+        double offset = 2.0 * KEPLER_PI * p * w.phasing / w.total;
+        for (int s = 0; s < perPlane; ++s)
+            swarm.push(center, circularAt(r, offset + 2.0 * KEPLER_PI * s / perPlane, mu), SwarmKind::Constellation, w.mass, armed);
+    }
+    return static_cast<size_t>(perPlane) * w.planes;
+}
+
+// n bodies with periapsis radii uniform in [rMin, rMax], eccentricities up to
+// maxEccentricity and random orientation; each starts at its periapsis.
+inline void spawnShell(Swarm& swarm, size_t n, double rMin, double rMax, double maxEccentricity, float mass, uint64_t seed,
+    sf::Vector2f center, double mu, float armed)
+{
+    swarm.reserve(n);
+    for (size_t k = 0; k < n; ++k)
+    {
+        auto bits = philox4x32({ uint32_t(k), uint32_t(k >> 32), 2u, 0u }, { uint32_t(seed), uint32_t(seed >> 32) });
+        double rp = rMin + (rMax - rMin) * uniform01(bits[0]);
+        double e = maxEccentricity * uniform01(bits[1]);
+        KeplerState s = circularAt(rp, 2.0 * KEPLER_PI * uniform01(bits[2]), mu);
+        s.v = s.v * std::sqrt(1.0 + e);
+        swarm.push(center, s, SwarmKind::Shell, mass, armed);
+    }
+}
+
+// n fragments around a parent state (relative to the center), with Gaussian
+// position and velocity spreads per axis.
+inline void spawnDebris(Swarm& swarm, size_t n, const KeplerState& parent, double sigmaPosition, double sigmaVelocity,
+    float mass, uint64_t seed, sf::Vector2f center, float armed)
+{
+    swarm.reserve(n);
+    for (size_t k = 0; k < n; ++k)
+    {
+        std::array<double, 4> g = memberNormals(k, seed);
+        KeplerState s = { parent.r + Vec2d(g[0], g[1]) * sigmaPosition, parent.v + Vec2d(g[2], g[3]) * sigmaVelocity };
+        swarm.push(center, s, SwarmKind::Debris, mass, armed);
+    }
+}
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "Events.h"
+#include "Kepler.h"
+#include "Parallel.h"
+#include "Physics.h"
+
+// Parameter sweep over the force-model constants. Every combination is one
+// headless propagation of the base orbit with the constants passed in as data,
+// so nothing has to be recompiled; combinations are shared out across threads
+// and each one leaves a single row in the result table.
+
+struct SweepRange
+{
+    double lo = 0.0, hi = 0.0;
+    int count = 1;
+
+    double value(int i) const { return count > 1 ? lo + (hi - lo) * i / (count - 1) : lo; }
+};
+
+// "value" or "lo:hi:count"
+inline bool parseRange(const char* text, SweepRange& out)
+{
+    char* end = nullptr;
+    SweepRange r;
+    r.lo = r.hi = std::strtod(text, &end);
+    if (end == text) return false;
+    if (*end == ':')
+    {
+        const char* next = end + 1;
+        r.hi = std::strtod(next, &end);
+        if (end == next || *end != ':') return false;
+        next = end + 1;
+        r.count = static_cast<int>(std::strtol(next, &end, 10));
+        if (end == next || r.count < 1) return false;
+    }
+    if (*end != '\0') return false;
+    out = r;
+    return true;
+}
+
+// The runtime counterparts of G, EARTH_MASS, J2_STRENGTH, ORBIT_SPEED_SCALE and MAX_DT.
+struct ForceParams
+{
+    double g = 0.0, mass = 0.0, j2 = 0.0, speedScale = 1.0, maxDt = 0.0;
+};
+
+struct SweepSpec
+{
+    SweepRange g, mass, j2, speedScale, maxDt;
+    KeplerState base;             // relative to the central body, at speed scale 1 under baseMu
+    double baseMu = 1.0;          // base.v scales with sqrt(mu / baseMu) * speedScale
+    double minDist = 1e-3;
+    const DensityTable* atmosphere = nullptr;
+    double ballistic = 0.0;
+    double duration = 60.0;
+    double surfaceRadius = 0.0;
+    double escapeRadius = 1e9;
+
+    size_t combinations() const
+    {
+        return static_cast<size_t>(g.count) * mass.count * j2.count * speedScale.count * maxDt.count;
+    }
+
+    // row-major over (g, mass, j2, speedScale, maxDt), maxDt fastest
+    ForceParams params(size_t index) const
+    {
+        ForceParams p;
+        p.maxDt = maxDt.value(static_cast<int>(index % maxDt.count)); index /= maxDt.count;
+        p.speedScale = speedScale.value(static_cast<int>(index % speedScale.count)); index /= speedScale.count;
+        p.j2 = j2.value(static_cast<int>(index % j2.count)); index /= j2.count;
+        p.mass = mass.value(static_cast<int>(index % mass.count)); index /= mass.count;
+        p.g = g.value(static_cast<int>(index));
+        return p;
+    }
+};
+
+enum class SweepOutcome : uint8_t { Bound, Impact, Escape };
+
+struct SweepRow
+{
+    ForceParams params;
+    SweepOutcome outcome = SweepOutcome::Bound;
+    double tEnd = 0.0;            // impact or escape time, else the duration
+    double rMin = 0.0, rMax = 0.0;
+    int periapses = 0;
+    double energyChange = 0.0;    // specific orbital energy at the end minus at the start
+};
+
+inline double orbitalEnergy(const KeplerState& s, double mu)
+{
+    return 0.5 * dot(s.v, s.v) - mu / norm(s.r);
+}
+
+// One combination: semi-implicit Euler with the scalar force, impacts and
+// periapsis passes located inside each step.
+inline SweepRow runSweepCase(const SweepSpec& spec, const ForceParams& p)
+{
+    ForceModel force;
+    force.mu = static_cast<float>(p.g * p.mass);
+    force.j2 = static_cast<float>(p.j2);
+    force.minDist = static_cast<float>(spec.minDist);
+    force.atmosphere = spec.atmosphere;
+    force.ballistic = static_cast<float>(spec.ballistic);
+    const double mu = force.mu;
+
+    KeplerState s = spec.base;
+    s.v = s.v * (std::sqrt(std::max(mu, 0.0) / spec.baseMu) * p.speedScale);
+
+    SweepRow row;
+    row.params = p;
+    row.rMin = row.rMax = norm(s.r);
+    const double e0 = orbitalEnergy(s, mu);
+    const EventSpec events = { spec.surfaceRadius, {}, true };
+    std::vector<OrbitEvent> found;
+
+    const int steps = std::max(1, static_cast<int>(std::ceil(spec.duration / p.maxDt)));
+    const double dt = spec.duration / steps;
+    double t = 0.0;
+    for (int i = 0; i < steps; ++i)
+    {
+        KeplerState before = s;
+        s.v += accelerationAt(force, s.r, s.v) * dt;
+        s.r += s.v * dt;
+
+        found.clear();
+        bool impact = detectEvents({ t, t + dt, before, s }, events, found);
+        for (const OrbitEvent& e : found)
+        {
+            if (e.kind == EventKind::Periapsis) ++row.periapses;
+            row.rMin = std::min(row.rMin, norm(e.state.r));
+        }
+        t += dt;
+
+        double r = norm(s.r);
+        row.rMin = std::min(row.rMin, r);
+        row.rMax = std::max(row.rMax, r);
+        if (impact)
+        {
+            row.outcome = SweepOutcome::Impact;
+            s = found.back().state;
+            t = found.back().t;
+            break;
+        }
+        if (r > spec.escapeRadius)
+        {
+            row.outcome = SweepOutcome::Escape;
+            break;
+        }
+    }
+
+    row.tEnd = t;
+    row.energyChange = orbitalEnergy(s, mu) - e0;
+    return row;
+}
+
+inline std::vector<SweepRow> runSweep(const SweepSpec& spec, unsigned threads, double* milliseconds = nullptr)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::vector<SweepRow> rows(spec.combinations());
+    parallelFor(rows.size(), 1, threads, "sweep", [&](size_t first, size_t last, unsigned)
+    {
+        for (size_t i = first; i < last; ++i) rows[i] = runSweepCase(spec, spec.params(i));
+    });
+
+    if (milliseconds)
+        *milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return rows;
+}
+
+inline const char* outcomeName(SweepOutcome o)
+{
+    switch (o)
+    {
+    case SweepOutcome::Impact: return "impact";
+    case SweepOutcome::Escape: return "escape";
+    default: return "bound";
+    }
+}
+
+// One line per combination; CSV when csv is set, aligned columns otherwise.
+inline void writeSweepTable(std::FILE* f, const std::vector<SweepRow>& rows, bool csv)
+{
+    const char* header = csv
+        ? "g,mass,j2,speed_scale,max_dt,outcome,t_end,r_min,r_max,periapses,d_energy\n"
+        : "       g      mass        j2   speed   max_dt  outcome     t_end     r_min     r_max  peri    d_energy\n";
+    std::fputs(header, f);
+    for (const SweepRow& r : rows)
+    {
+        const ForceParams& p = r.params;
+        std::fprintf(f, csv ? "%g,%g,%g,%g,%g,%s,%.4f,%.3f,%.3f,%d,%.6g\n"
+                            : "%8.4g %9.5g %9.3g %7.3g %8.4g  %-7s %9.3f %9.2f %9.2f %5d %11.4g\n",
+            p.g, p.mass, p.j2, p.speedScale, p.maxDt, outcomeName(r.outcome),
+            r.tEnd, r.rMin, r.rMax, r.periapses, r.energyChange);
+    }
+}
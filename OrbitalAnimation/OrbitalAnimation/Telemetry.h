@@ -0,0 +1,267 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Simd.h"
+#include "Trace.h"
+
+const size_t TELEMETRY_INTERVAL = 10;     // physics steps between telemetry passes
+const size_t TELEMETRY_REPORT_EVERY = 20; // samples between console reports
+const int TELEMETRY_BINS = 16;            // energy drift histogram, 2 octaves per bin from 2^-32
+
+// Conserved quantities of the two-body problem, relative to the central body.
+struct OrbitInvariants
+{
+    float energy = 0.f;           // specific orbital energy
+    float angularMomentum = 0.f;  // specific angular momentum (z component)
+    float eccentricity = 0.f;
+};
+
+inline OrbitInvariants orbitInvariants(sf::Vector2f r, sf::Vector2f v, float mu, float minDist)
+{
+    float dist = std::max(std::sqrt(r.x * r.x + r.y * r.y), minDist);
+    float v2 = v.x * v.x + v.y * v.y;
+    float rv = r.x * v.x + r.y * v.y;
+
+    OrbitInvariants inv;
+    inv.energy = 0.5f * v2 - mu / dist;
+    inv.angularMomentum = r.x * v.y - r.y * v.x;
+
+    sf::Vector2f e = (r * (v2 - mu / dist) - v * rv) / mu;
+    inv.eccentricity = std::sqrt(e.x * e.x + e.y * e.y);
+    return inv;
+}
+
+struct DriftStats
+{
+    float min = 0.f;
+    float max = 0.f;
+    float mean = 0.f;
+};
+
+struct TelemetrySample
+{
+    size_t step = 0;
+    size_t bodies = 0;
+    DriftStats energy;            // (E - E0) / |E0|
+    DriftStats angularMomentum;   // (h - h0) / |h0|
+    DriftStats eccentricity;      // e - e0
+    std::array<uint32_t, TELEMETRY_BINS> energyHistogram{};
+};
+
+// Structure-of-arrays snapshot filled by the caller. Positions are relative to
+// the central body; ref* hold the invariants each body started with.
+struct TelemetryBatch
+{
+    std::vector<float> rx, ry, vx, vy;
+    std::vector<float> refEnergy, refAngMom, refEcc;
+    std::vector<float> energyDrift;
+    std::vector<int32_t> exponent;
+
+    void clear()
+    {
+        rx.clear(); ry.clear(); vx.clear(); vy.clear();
+        refEnergy.clear(); refAngMom.clear(); refEcc.clear();
+    }
+
+    void push(sf::Vector2f r, sf::Vector2f v, const OrbitInvariants& ref)
+    {
+        rx.push_back(r.x); ry.push_back(r.y);
+        vx.push_back(v.x); vy.push_back(v.y);
+        refEnergy.push_back(ref.energy);
+        refAngMom.push_back(ref.angularMomentum);
+        refEcc.push_back(ref.eccentricity);
+    }
+
+    size_t size() const { return rx.size(); }
+};
+
+// Computes per-body drift four lanes at a time and reduces it to min/max/mean
+// plus a histogram of |dE/E|. The batch is padded in place to a multiple of 4.
+inline TelemetrySample reduceTelemetry(TelemetryBatch& b, float mu, float minDist, size_t step)
+{
+    TelemetrySample out;
+    out.step = step;
+    out.bodies = b.size();
+    if (b.size() == 0) return out;
+
+    const size_t n = b.size();
+    const size_t padded = (n + 3) & ~size_t(3);
+    for (std::vector<float>* a : { &b.rx, &b.ry, &b.vx, &b.vy, &b.refEnergy, &b.refAngMom, &b.refEcc })
+        a->resize(padded, a->back());
+    b.energyDrift.resize(padded);
+    b.exponent.resize(padded);
+
+    const float inf = std::numeric_limits<float>::infinity();
+    const f32x4 vmu(mu), vinvMu(1.f / mu), vminDist(minDist), half(0.5f), tiny(1e-20f);
+    const f32x4 lane(0.f, 1.f, 2.f, 3.f), count(static_cast<float>(n));
+    f32x4 minE(inf), maxE(-inf), sumE, minH(inf), maxH(-inf), sumH, minEc(inf), maxEc(-inf), sumEc;
+
+    for (size_t i = 0; i < padded; i += 4)
+    {
+        f32x4 rx = f32x4::load(&b.rx[i]), ry = f32x4::load(&b.ry[i]);
+        f32x4 vx = f32x4::load(&b.vx[i]), vy = f32x4::load(&b.vy[i]);
+
+        f32x4 dist = max(sqrt(rx * rx + ry * ry), vminDist);
+        f32x4 v2 = vx * vx + vy * vy;
+        f32x4 rv = rx * vx + ry * vy;
+        f32x4 muOverR = vmu / dist;
+
+        f32x4 E = half * v2 - muOverR;
+        f32x4 h = rx * vy - ry * vx;
+        f32x4 k = v2 - muOverR;
+        f32x4 ex = (rx * k - vx * rv) * vinvMu;
+        f32x4 ey = (ry * k - vy * rv) * vinvMu;
+        f32x4 ecc = sqrt(ex * ex + ey * ey);
+
+        f32x4 E0 = f32x4::load(&b.refEnergy[i]);
+        f32x4 h0 = f32x4::load(&b.refAngMom[i]);
+        f32x4 dE = (E - E0) / max(abs(E0), tiny);
+        f32x4 dH = (h - h0) / max(abs(h0), tiny);
+        f32x4 dEc = ecc - f32x4::load(&b.refEcc[i]);
+
+        dE.store(&b.energyDrift[i]);
+        exponents(dE, &b.exponent[i]);
+
+        f32x4 valid = (f32x4(static_cast<float>(i)) + lane) < count;
+        minE = min(minE, select(valid, dE, f32x4(inf)));
+        maxE = max(maxE, select(valid, dE, f32x4(-inf)));
+        sumE += valid & dE;
+        minH = min(minH, select(valid, dH, f32x4(inf)));
+        maxH = max(maxH, select(valid, dH, f32x4(-inf)));
+        sumH += valid & dH;
+        minEc = min(minEc, select(valid, dEc, f32x4(inf)));
+        maxEc = max(maxEc, select(valid, dEc, f32x4(-inf)));
+        sumEc += valid & dEc;
+    }
+
+    const float invN = 1.f / static_cast<float>(n);
+    out.energy = { hmin(minE), hmax(maxE), hsum(sumE) * invN };
+    out.angularMomentum = { hmin(minH), hmax(maxH), hsum(sumH) * invN };
+    out.eccentricity = { hmin(minEc), hmax(maxEc), hsum(sumEc) * invN };
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        // exact zero drift lands in the lowest bin
+        int bin = b.energyDrift[i] == 0.f ? 0 : (b.exponent[i] + 32) / 2;
+        ++out.energyHistogram[std::clamp(bin, 0, TELEMETRY_BINS - 1)];
+    }
+
+    return out;
+}
+
+// Single-producer / single-consumer ring. The physics thread pushes, the
+// reporter pops; neither side ever blocks. Full ring drops the newest sample.
+template <typename T, size_t Capacity>
+struct MetricsRing
+{
+    static_assert((Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+    std::array<T, Capacity> slots{};
+    alignas(64) std::atomic<size_t> head{ 0 };  // next slot to write
+    alignas(64) std::atomic<size_t> tail{ 0 };  // next slot to read
+    std::atomic<size_t> dropped{ 0 };
+
+    bool tryPush(const T& item)
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == Capacity)
+        {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        slots[h & (Capacity - 1)] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& item)
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) return false;
+        item = slots[t & (Capacity - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+using TelemetryRing = MetricsRing<TelemetrySample, 64>;
+
+// Drains the ring and formats reports on its own thread. The finished lines
+// wait in an outbox for the main thread to print, so they never interleave
+// with its own console output.
+struct TelemetryReporter
+{
+    TelemetryRing& ring;
+    std::mutex outboxMutex;
+    std::string outbox;
+    std::jthread worker;           // last, so it starts after the outbox exists
+
+    explicit TelemetryReporter(TelemetryRing& r)
+        : ring(r), worker([this](std::stop_token stop) { run(stop); })
+    {
+    }
+
+    void run(std::stop_token stop)
+    {
+        nameTraceThread("telemetry reporter");
+        size_t received = 0;
+        TelemetrySample s;
+        while (!stop.stop_requested())
+        {
+            bool drained = false;
+            {
+                TraceScope trace("telemetry drain");
+                while (ring.tryPop(s))
+                {
+                    drained = true;
+                    if (++received % TELEMETRY_REPORT_EVERY == 0) format(s);
+                }
+            }
+            if (!drained) std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+    }
+
+    void format(const TelemetrySample& s)
+    {
+        char line[320];
+        std::snprintf(line, sizeof(line), "telemetry step %zu bodies %zu | dE/E [%.2e %.2e] mean %.2e | dh/h [%.2e %.2e] mean %.2e | de [%.2e %.2e] mean %.2e | dropped %zu\n",
+            s.step, s.bodies,
+            s.energy.min, s.energy.max, s.energy.mean,
+            s.angularMomentum.min, s.angularMomentum.max, s.angularMomentum.mean,
+            s.eccentricity.min, s.eccentricity.max, s.eccentricity.mean,
+            ring.dropped.load(std::memory_order_relaxed));
+        std::string report = line;
+
+        report += "  |dE/E| histogram (2^-32 .. 1):";
+        for (uint32_t c : s.energyHistogram) report += " " + std::to_string(c);
+        report += "\n";
+
+        std::lock_guard lock(outboxMutex);
+        outbox += report;
+    }
+
+    // Print whatever reports are waiting; called from the thread that owns the console.
+    void flush(std::ostream& out)
+    {
+        std::string text;
+        {
+            std::lock_guard lock(outboxMutex);
+            text.swap(outbox);
+        }
+        if (!text.empty()) out << text << std::flush;
+    }
+};
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "Kepler.h"
+
+// Third-body perturbations (Moon, Sun). Each body's path relative to the
+// central body is tabulated once over one period with positions and
+// velocities, and read back by cubic Hermite interpolation. A step samples
+// every table once into a ThirdBodyField that all satellites share, so the
+// kernels only add the tidal term per body:
+//   mu_b * ((d - x) / |d - x|^3 - d / |d|^3)
+// where the second part is the pull on the central body itself.
+
+const int THIRD_BODY_MAX = 2;
+
+// Body positions at one instant, relative to the central body.
+struct ThirdBodyField
+{
+    int count = 0;
+    float x[THIRD_BODY_MAX] = {}, y[THIRD_BODY_MAX] = {};
+    float mu[THIRD_BODY_MAX] = {};
+    float ax = 0.f, ay = 0.f;     // summed acceleration of the central body toward the bodies
+};
+
+// Scalar double-precision tidal acceleration at x, relative to the center.
+inline Vec2d thirdBodyAcceleration(const ThirdBodyField& f, Vec2d x)
+{
+    Vec2d a(-f.ax, -f.ay);
+    for (int b = 0; b < f.count; ++b)
+    {
+        Vec2d s = Vec2d(f.x[b], f.y[b]) - x;
+        double s2 = dot(s, s);
+        a += s * (f.mu[b] / (s2 * std::sqrt(s2)));
+    }
+    return a;
+}
+
+struct ThirdBodyTable
+{
+    double mu = 0.0;              // G * M of the body
+    double period = 0.0;          // the table wraps around after one period
+    double step = 0.0;
+    std::vector<KeplerState> samples;
+
+    Vec2d at(double t) const
+    {
+        double u = (t - period * std::floor(t / period)) / step;
+        size_t i = std::min(static_cast<size_t>(u), samples.size() - 1);
+        double f = u - static_cast<double>(i);
+        const KeplerState& p = samples[i];
+        const KeplerState& q = samples[(i + 1) % samples.size()];
+
+        double f2 = f * f, f3 = f2 * f;
+        double h00 = 2.0 * f3 - 3.0 * f2 + 1.0, h10 = f3 - 2.0 * f2 + f;
+        double h01 = -2.0 * f3 + 3.0 * f2, h11 = f3 - f2;
+        return p.r * h00 + p.v * (h10 * step) + q.r * h01 + q.v * (h11 * step);
+    }
+};
+
+// Tabulate a body's bound orbit about the central body, starting at epoch 0.
+// muPair is G * (M_center + M_body), which sets the period.
+inline ThirdBodyTable tabulateBody(double mu, const KeplerState& start, double muPair, int samples)
+{
+    ThirdBodyTable t;
+    t.mu = mu;
+    t.period = orbitTimescale(start, muPair);
+    t.step = t.period / samples;
+    t.samples.reserve(samples);
+    for (int i = 0; i < samples; ++i)
+        t.samples.push_back(keplerPropagate(start, t.step * i, muPair));
+    return t;
+}
+
+struct ThirdBodies
+{
+    std::vector<ThirdBodyTable> tables;
+
+    // Interpolate every body once for time t.
+    ThirdBodyField at(double t) const
+    {
+        ThirdBodyField f;
+        for (const ThirdBodyTable& table : tables)
+        {
+            if (f.count == THIRD_BODY_MAX) break;
+            Vec2d d = table.at(t);
+            double d2 = dot(d, d);
+            Vec2d pull = d * (table.mu / (d2 * std::sqrt(d2)));
+            f.x[f.count] = static_cast<float>(d.x);
+            f.y[f.count] = static_cast<float>(d.y);
+            f.mu[f.count] = static_cast<float>(table.mu);
+            f.ax += static_cast<float>(pull.x);
+            f.ay += static_cast<float>(pull.y);
+            ++f.count;
+        }
+        return f;
+    }
+};
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+
+// Time warp: the sim runs `factor` sim seconds per real second. A frame's
+// share is cut into equal substeps no longer than the stability clamp, and
+// substeps stop once the frame's physics budget is spent. The sim time left
+// over is dropped, so a warp the machine cannot sustain runs slower instead of
+// stalling the frame rate. The budget is whatever the frame target leaves
+// after the previous frame's other phases. A warp that keeps falling short
+// is flagged as behind, which the quality governor (Governor.h) takes as
+// pressure to free more of the frame.
+
+const double WARP_MAX = 1e5;
+const float WARP_FRAME_MS = 1000.f / 60.f;    // target frame time
+const float WARP_MIN_BUDGET_MS = 4.f;         // physics gets at least this much of a frame
+const int WARP_REPORT_FRAMES = 30;            // frames short (or met) before the warp counts as behind (or caught up)
+const int WARP_TRAIL_SAMPLES = 8;             // trail sampling points per frame, however many substeps
+
+// Next step on the 1-2-5 ladder from 1x to WARP_MAX.
+inline double nextWarp(double factor, bool up)
+{
+    const double ladder[3] = { 1.0, 2.0, 5.0 };
+    const int top = 3 * static_cast<int>(std::lround(std::log10(WARP_MAX)));
+    int decade = static_cast<int>(std::floor(std::log10(std::max(factor, 1.0)) + 1e-9));
+    double mantissa = factor / std::pow(10.0, decade);
+    int index = 3 * decade + (mantissa < 1.5 ? 0 : mantissa < 3.5 ? 1 : 2) + (up ? 1 : -1);
+    index = std::clamp(index, 0, top);
+    return ladder[index % 3] * std::pow(10.0, index / 3);
+}
+
+struct TimeWarp
+{
+    double factor = 1.0;          // requested
+    double achieved = 1.0;        // sim seconds per real second, smoothed over recent frames
+    bool behind = false;          // the requested factor is currently missed
+
+    // this frame
+    int substeps = 1, done = 0;
+    int reach = 1;                // substeps expected to fit, from the last frame
+    float h = 0.f;                // substep length, sim seconds
+    float budgetMs = 0.f;
+    float firstMs = 0.f;          // the first substep, what physics costs at 1x
+    std::chrono::steady_clock::time_point start;
+
+    int fitted = INT_MAX;         // substeps the last frame managed if it ran out of budget
+    int shortFrames = 0, metFrames = 0;
+
+    void set(double f)
+    {
+        factor = std::clamp(f, 1.0, WARP_MAX);
+        achieved = factor;
+        behind = false;
+        fitted = INT_MAX;
+        shortFrames = metFrames = 0;
+    }
+
+    float elapsedMs() const
+    {
+        return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Plan the frame's substeps for realDt seconds of wall time; otherMs is
+    // what the rest of the last frame took.
+    void begin(float realDt, float maxDt, float otherMs)
+    {
+        const double sim = realDt * factor;
+        substeps = std::max(1, static_cast<int>(std::ceil(sim / maxDt - 1e-6)));
+        h = static_cast<float>(sim / substeps);
+        done = 0;
+        reach = std::clamp(fitted, 1, substeps);
+        budgetMs = std::max(WARP_FRAME_MS - otherMs, WARP_MIN_BUDGET_MS);
+        start = std::chrono::steady_clock::now();
+    }
+
+    // Whether the substep under way should sample the trails: samples are
+    // spread evenly over the substeps expected to fit.
+    bool trailDue() const
+    {
+        const int stride = (reach + WARP_TRAIL_SAMPLES - 1) / WARP_TRAIL_SAMPLES;
+        return (done + 1) % stride == 0;
+    }
+
+    // Finish a substep; true while another is planned and fits the budget.
+    // The first substep always runs, so 1x never falls behind.
+    bool next()
+    {
+        const float elapsed = elapsedMs();
+        if (++done == 1) firstMs = elapsed;
+        return done < substeps && elapsed < budgetMs;
+    }
+
+    // Close the frame. Returns true when the warp has just become missed, or
+    // met again, so the caller can report it.
+    bool end(float realDt)
+    {
+        const bool missed = done < substeps;
+        if (realDt > 0.f) achieved += (done * h / realDt - achieved) * 0.1;
+        fitted = missed ? done : INT_MAX;
+
+        shortFrames = missed ? shortFrames + 1 : 0;
+        metFrames = missed ? 0 : metFrames + 1;
+
+        if (!behind && shortFrames >= WARP_REPORT_FRAMES)
+        {
+            behind = true;
+            return true;
+        }
+        if (behind && metFrames >= WARP_REPORT_FRAMES)
+        {
+            behind = false;
+            return true;
+        }
+        return false;
+    }
+};
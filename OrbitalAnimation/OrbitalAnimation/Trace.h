@@ -0,0 +1,249 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+const float TRACE_SECONDS = 5.f;              // length of one capture
+const size_t TRACE_EVENTS_PER_THREAD = 1 << 18;
+
+// Chrome trace-event recorder. Each thread appends complete ("X") events to
+// its own fixed buffer without locks; the mutex is only taken when a thread
+// takes or gives back a buffer and when a finished capture is written out.
+// A thread takes a buffer on its first event inside a capture, so threads
+// cost nothing while no capture runs, and hands it back to a free list when
+// it exits. A buffer that still holds events waits in the registry until its
+// capture has been written (or the next one starts).
+
+struct TraceEvent
+{
+    const char* name;
+    int64_t beginUs;
+    int64_t durationUs;
+};
+
+struct TraceBuffer
+{
+    std::vector<TraceEvent> events;
+    std::atomic<size_t> count{ 0 };
+    uint32_t tid = 0;
+    std::string threadName;       // under registryMutex
+    bool owned = false;           // a live thread records into it; under registryMutex
+    bool pooled = false;          // on the free list; under registryMutex
+};
+
+struct TraceSession
+{
+    std::atomic<bool> active{ false };
+    std::atomic<int64_t> startUs{ 0 };
+    int64_t endUs = 0;
+    int captures = 0;
+
+    std::mutex registryMutex;
+    std::vector<std::unique_ptr<TraceBuffer>> buffers;
+    std::vector<TraceBuffer*> free;
+};
+
+inline TraceSession& traceSession()
+{
+    static TraceSession session;
+    return session;
+}
+
+inline int64_t traceNowUs()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Put an unowned buffer back on the free list, empty. Needs registryMutex.
+inline void poolTraceBuffer(TraceSession& s, TraceBuffer& b)
+{
+    b.count.store(0, std::memory_order_relaxed);
+    b.threadName.clear();
+    b.pooled = true;
+    s.free.push_back(&b);
+}
+
+// The calling thread's name and buffer; the buffer goes back when the thread exits.
+struct ThreadTraceSlot
+{
+    const char* name = nullptr;
+    TraceBuffer* buffer = nullptr;
+
+    ~ThreadTraceSlot()
+    {
+        if (!buffer) return;
+        TraceSession& s = traceSession();
+        std::lock_guard<std::mutex> lock(s.registryMutex);
+        buffer->owned = false;
+        if (buffer->count.load(std::memory_order_relaxed) == 0) poolTraceBuffer(s, *buffer);
+    }
+};
+
+inline ThreadTraceSlot& threadTraceSlot()
+{
+    thread_local ThreadTraceSlot slot;
+    return slot;
+}
+
+// Buffer of the calling thread, taken from the free list (or allocated) on first use.
+inline TraceBuffer& threadTraceBuffer()
+{
+    ThreadTraceSlot& slot = threadTraceSlot();
+    if (!slot.buffer)
+    {
+        TraceSession& s = traceSession();
+        std::lock_guard<std::mutex> lock(s.registryMutex);
+        if (s.free.empty())
+        {
+            auto fresh = std::make_unique<TraceBuffer>();
+            fresh->events.resize(TRACE_EVENTS_PER_THREAD);
+            fresh->tid = static_cast<uint32_t>(s.buffers.size() + 1);
+            s.free.push_back(fresh.get());
+            s.buffers.push_back(std::move(fresh));
+        }
+        slot.buffer = s.free.back();
+        s.free.pop_back();
+        slot.buffer->pooled = false;
+        slot.buffer->owned = true;
+        if (slot.name) slot.buffer->threadName = slot.name;
+    }
+    return *slot.buffer;
+}
+
+// Names the calling thread in captures; takes no buffer.
+inline void nameTraceThread(const char* name)
+{
+    ThreadTraceSlot& slot = threadTraceSlot();
+    slot.name = name;
+    if (slot.buffer)
+    {
+        std::lock_guard<std::mutex> lock(traceSession().registryMutex);
+        slot.buffer->threadName = name;
+    }
+}
+
+inline void traceRecord(const char* name, int64_t beginUs, int64_t endUs)
+{
+    TraceSession& s = traceSession();
+    if (!s.active.load(std::memory_order_acquire) || beginUs < s.startUs.load(std::memory_order_relaxed)) return;
+
+    TraceBuffer& b = threadTraceBuffer();
+    size_t n = b.count.load(std::memory_order_relaxed);
+    if (n >= b.events.size()) return;   // buffer full: drop rather than grow
+    b.events[n] = { name, beginUs, endUs - beginUs };
+    b.count.store(n + 1, std::memory_order_release);
+}
+
+// RAII trace span. Costs one relaxed load when no capture is running.
+struct TraceScope
+{
+    const char* name;
+    int64_t start = 0;
+
+    explicit TraceScope(const char* n) : name(n)
+    {
+        if (traceSession().active.load(std::memory_order_relaxed)) start = traceNowUs();
+    }
+
+    ~TraceScope()
+    {
+        if (start != 0) traceRecord(name, start, traceNowUs());
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+};
+
+inline void startTrace(float seconds)
+{
+    TraceSession& s = traceSession();
+    if (s.active.load()) return;
+
+    {
+        std::lock_guard<std::mutex> lock(s.registryMutex);
+        for (auto& b : s.buffers)
+        {
+            b->count.store(0, std::memory_order_relaxed);
+            if (!b->owned && !b->pooled) poolTraceBuffer(s, *b);
+        }
+    }
+    const int64_t start = traceNowUs();
+    s.startUs.store(start, std::memory_order_relaxed);
+    s.endUs = start + static_cast<int64_t>(seconds * 1e6f);
+    s.active.store(true, std::memory_order_release);
+    std::printf("trace: capturing %.1f s\n", seconds);
+}
+
+inline void writeJsonString(std::FILE* f, const std::string& str)
+{
+    std::fputc('"', f);
+    for (char c : str)
+    {
+        if (c == '"' || c == '\\') std::fputc('\\', f);
+        std::fputc(c, f);
+    }
+    std::fputc('"', f);
+}
+
+// Writes the capture as Chrome trace-event JSON (loads in Perfetto / chrome://tracing).
+inline bool writeTrace(const char* path)
+{
+    TraceSession& s = traceSession();
+    std::FILE* f = std::fopen(path, "w");
+    if (!f) return false;
+
+    std::lock_guard<std::mutex> lock(s.registryMutex);
+    const int64_t startUs = s.startUs.load(std::memory_order_relaxed);
+    std::fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    for (const auto& b : s.buffers)
+    {
+        if (!b->threadName.empty())
+        {
+            std::fprintf(f, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":",
+                first ? "" : ",\n", b->tid);
+            writeJsonString(f, b->threadName);
+            std::fprintf(f, "}}");
+            first = false;
+        }
+
+        size_t n = b->count.load(std::memory_order_acquire);
+        for (size_t i = 0; i < n; ++i)
+        {
+            const TraceEvent& e = b->events[i];
+            std::fprintf(f, "%s{\"ph\":\"X\",\"name\":", first ? "" : ",\n");
+            writeJsonString(f, e.name);
+            std::fprintf(f, ",\"pid\":1,\"tid\":%u,\"ts\":%lld,\"dur\":%lld}",
+                b->tid, static_cast<long long>(e.beginUs - startUs), static_cast<long long>(e.durationUs));
+            first = false;
+        }
+    }
+    std::fprintf(f, "\n]}\n");
+    std::fclose(f);
+    return true;
+}
+
+// Call once per frame: ends a running capture when its window has elapsed.
+inline void pollTrace()
+{
+    TraceSession& s = traceSession();
+    if (!s.active.load(std::memory_order_relaxed) || traceNowUs() < s.endUs) return;
+
+    s.active.store(false, std::memory_order_release);
+    char path[64];
+    std::snprintf(path, sizeof(path), "trace_%d.json", s.captures++);
+    if (writeTrace(path)) std::printf("trace: wrote %s\n", path);
+    else std::printf("trace: could not write %s\n", path);
+
+    // buffers of threads that exited during the capture are free again
+    std::lock_guard<std::mutex> lock(s.registryMutex);
+    for (auto& b : s.buffers)
+        if (!b->owned && !b->pooled) poolTraceBuffer(s, *b);
+}
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+#include "Kepler.h"
+#include "Simd.h"
+
+// Three-dimensional propagation under zonal gravity. The potential is
+//   U = mu / r * (1 - sum_n J_n (R / r)^n P_n(z / r)),  n = 2 .. degree
+// and its gradient needs only P_n and P_n' of u = z / r, which come from the
+// upward (Bonnet) recursion; it is stable for |u| <= 1 and runs the same
+// number of terms in every lane, so it vectorizes across bodies unchanged.
+// With S = sum J_n rho^n ((n + 1) P_n + u P_n') and T = sum J_n rho^n P_n':
+//   a = mu / r^3 * ((S - 1) x, (S - 1) y, (S - 1) z - r T)
+// Positions are relative to the planet's centre, z along its spin axis.
+
+using Vec3d = sf::Vector3<double>;
+
+inline double dot(Vec3d a, Vec3d b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline Vec3d cross(Vec3d a, Vec3d b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+inline double norm(Vec3d a) { return std::sqrt(dot(a, a)); }
+
+const int ZONAL_MAX_DEGREE = 8;
+
+// Earth's unnormalized zonal coefficients, J2 .. J8.
+const double EARTH_ZONALS[ZONAL_MAX_DEGREE + 1] = {
+    0.0, 0.0, 1.08262668e-3, -2.53265649e-6, -1.61962159e-6,
+    -2.27296083e-7, 5.40681239e-7, -3.52359603e-7, -2.04809e-7
+};
+
+struct ZonalModel
+{
+    float mu = 0.f;
+    float radius = 0.f;           // reference radius of the J_n
+    int degree = 2;               // highest zonal term used
+    std::array<float, ZONAL_MAX_DEGREE + 1> j{};
+};
+
+inline ZonalModel makeZonalModel(float mu, float radius, int degree)
+{
+    ZonalModel m;
+    m.mu = mu;
+    m.radius = radius;
+    m.degree = std::clamp(degree, 1, ZONAL_MAX_DEGREE);
+    for (int n = 2; n <= m.degree; ++n) m.j[n] = static_cast<float>(EARTH_ZONALS[n]);
+    return m;
+}
+
+// Scalar double-precision form of the batch kernel's force.
+inline Vec3d zonalAcceleration(const ZonalModel& m, Vec3d x)
+{
+    double r = norm(x);
+    double u = x.z / r, rho = m.radius / r;
+    double pPrev = 1.0, p = u, dp = 1.0, rhoN = rho;
+    double s = 0.0, t = 0.0;
+    for (int n = 2; n <= m.degree; ++n)
+    {
+        double pn = ((2 * n - 1) * u * p - (n - 1) * pPrev) / n;
+        double dpn = n * p + u * dp;
+        rhoN *= rho;
+        double c = m.j[n] * rhoN;
+        s += c * ((n + 1) * pn + u * dpn);
+        t += c * dpn;
+        pPrev = p; p = pn; dp = dpn;
+    }
+    double k = m.mu / (r * r * r);
+    return Vec3d(x.x * (s - 1.0), x.y * (s - 1.0), x.z * (s - 1.0) - r * t) * k;
+}
+
+// Structure-of-arrays scratch for 3-D bodies, like BodyBatch.
+struct BodyBatch3
+{
+    std::vector<float> px, py, pz, vx, vy, vz;
+
+    void clear() { for (std::vector<float>* a : { &px, &py, &pz, &vx, &vy, &vz }) a->clear(); }
+
+    void push(Vec3d p, Vec3d v)
+    {
+        px.push_back(static_cast<float>(p.x)); py.push_back(static_cast<float>(p.y)); pz.push_back(static_cast<float>(p.z));
+        vx.push_back(static_cast<float>(v.x)); vy.push_back(static_cast<float>(v.y)); vz.push_back(static_cast<float>(v.z));
+    }
+
+    size_t size() const { return px.size(); }
+
+    Vec3d position(size_t i) const { return { px[i], py[i], pz[i] }; }
+    Vec3d velocity(size_t i) const { return { vx[i], vy[i], vz[i] }; }
+
+    // pad with copies of the last body so every lane group is full
+    void pad()
+    {
+        if (px.empty()) return;
+        size_t padded = (px.size() + 3) & ~size_t(3);
+        for (std::vector<float>* a : { &px, &py, &pz, &vx, &vy, &vz }) a->resize(padded, a->back());
+    }
+};
+
+// One semi-implicit Euler step of every body, four lanes at a time.
+inline void stepZonal(const ZonalModel& m, BodyBatch3& b, float dt)
+{
+    const size_t n = b.size();
+    b.pad();
+
+    // recursion coefficients, splatted once per call
+    f32x4 pa[ZONAL_MAX_DEGREE + 1], pb[ZONAL_MAX_DEGREE + 1], fn[ZONAL_MAX_DEGREE + 1], fn1[ZONAL_MAX_DEGREE + 1], jn[ZONAL_MAX_DEGREE + 1];
+    for (int d = 2; d <= m.degree; ++d)
+    {
+        pa[d] = f32x4(static_cast<float>(2 * d - 1) / d);
+        pb[d] = f32x4(static_cast<float>(d - 1) / d);
+        fn[d] = f32x4(static_cast<float>(d));
+        fn1[d] = f32x4(static_cast<float>(d + 1));
+        jn[d] = f32x4(m.j[d]);
+    }
+    const f32x4 mu(m.mu), radius(m.radius), one(1.f), vdt(dt);
+
+    for (size_t i = 0; i < b.size(); i += 4)
+    {
+        f32x4 x = f32x4::load(&b.px[i]), y = f32x4::load(&b.py[i]), z = f32x4::load(&b.pz[i]);
+        f32x4 vx = f32x4::load(&b.vx[i]), vy = f32x4::load(&b.vy[i]), vz = f32x4::load(&b.vz[i]);
+
+        f32x4 r = sqrt(x * x + y * y + z * z);
+        f32x4 invR = one / r;
+        f32x4 u = z * invR, rho = radius * invR;
+
+        f32x4 pPrev = one, p = u, dp = one, rhoN = rho;
+        f32x4 s, t;
+        for (int d = 2; d <= m.degree; ++d)
+        {
+            f32x4 pn = pa[d] * u * p - pb[d] * pPrev;
+            f32x4 dpn = fn[d] * p + u * dp;
+            rhoN *= rho;
+            f32x4 c = jn[d] * rhoN;
+            s += c * (fn1[d] * pn + u * dpn);
+            t += c * dpn;
+            pPrev = p; p = pn; dp = dpn;
+        }
+
+        f32x4 k = mu * invR * invR * invR;
+        f32x4 radial = k * (s - one);
+        vx += x * radial * vdt;
+        vy += y * radial * vdt;
+        vz += (z * radial - k * r * t) * vdt;
+        x += vx * vdt;
+        y += vy * vdt;
+        z += vz * vdt;
+
+        x.store(&b.px[i]); y.store(&b.py[i]); z.store(&b.pz[i]);
+        vx.store(&b.vx[i]); vy.store(&b.vy[i]); vz.store(&b.vz[i]);
+    }
+
+    for (std::vector<float>* a : { &b.px, &b.py, &b.pz, &b.vx, &b.vy, &b.vz }) a->resize(n);
+}
+
+// Circular orbit of the given radius, inclination and node, at argument of
+// latitude arg from the ascending node.
+inline void circularOrbit3(double mu, double radius, double inclination, double node, double arg, Vec3d& r, Vec3d& v)
+{
+    const double ci = std::cos(inclination), si = std::sin(inclination);
+    const double cn = std::cos(node), sn = std::sin(node);
+    const Vec3d e1(cn, sn, 0.0);                     // toward the ascending node
+    const Vec3d e2(-sn * ci, cn * ci, si);           // in plane, 90 degrees ahead
+    const double speed = std::sqrt(mu / radius);
+    r = (e1 * std::cos(arg) + e2 * std::sin(arg)) * radius;
+    v = (e1 * -std::sin(arg) + e2 * std::cos(arg)) * speed;
+}
+
+// Right ascension of the ascending node of the orbit through (r, v).
+inline double nodeOf(Vec3d r, Vec3d v)
+{
+    Vec3d h = cross(r, v);
+    return std::atan2(h.x, -h.y);
+}
+
+// A plane to draw 3-D positions in: the equator, or the orbital plane of a
+// reference state (x toward its ascending node).
+struct ViewPlane
+{
+    Vec3d e1{ 1.0, 0.0, 0.0 }, e2{ 0.0, 1.0, 0.0 };
+
+    Vec2d project(Vec3d p) const { return { dot(p, e1), dot(p, e2) }; }
+};
+
+inline ViewPlane orbitalPlane(Vec3d r, Vec3d v)
+{
+    Vec3d h = cross(r, v);
+    Vec3d node = cross(Vec3d(0.0, 0.0, 1.0), h);
+    ViewPlane plane;
+    double nn = norm(node);
+    if (nn < 1e-9 * norm(h)) return plane;           // equatorial orbit: the equator is its plane
+    plane.e1 = node / nn;
+    plane.e2 = cross(h / norm(h), plane.e1);
+    return plane;
+}